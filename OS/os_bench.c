@@ -0,0 +1,246 @@
+/**
+ * @file os_bench.c
+ * See os_bench.h. Each scenario fills a static sample buffer with per-call
+ * DWT cycle deltas, sorts it and reports min/median/p99. The percentiles
+ * matter more than the mean: the allocator is O(1) on average but its tail
+ * is what breaks a deadline.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_bench.h"
+
+#if OS_USE_BENCH
+
+#include "os_mem.h"
+#include "os_ll.h"
+#include "os_timer.h"
+#include "os_hal_tick.h"
+#include "os_uart.h"
+#include <stdio.h>
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Blocks kept live while building fragmentation*/
+#define BENCH_FRAG_BLOCK_CNT 192
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static uint32_t bench_cycles(void);
+static uint32_t bench_rand(void);
+static void bench_report(const char * name, uint32_t cnt);
+static void bench_mem_alloc_free(size_t size);
+static void bench_mem_fragmented(void);
+static void bench_ll_ins_remove(void);
+static void bench_timer_pass(void);
+static void bench_timer_noop_cb(os_timer_t * timer);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static uint32_t bench_samples[OS_BENCH_SAMPLE_CNT];
+static uint32_t bench_rand_state;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void os_bench_run(void)
+{
+    static const char hdr[] = "os_bench: cycles per call, "
+                              "min/median/p99 over 128 samples\r\n";
+    os_uart_write(hdr, sizeof(hdr) - 1);
+
+    bench_rand_state = 0x12345678UL;
+
+    bench_mem_alloc_free(16);
+    bench_mem_alloc_free(64);
+    bench_mem_alloc_free(256);
+    bench_mem_alloc_free(1024);
+    bench_mem_fragmented();
+    bench_ll_ins_remove();
+    bench_timer_pass();
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static uint32_t bench_cycles(void)
+{
+    return (uint32_t)os_tick_get_cycles();
+}
+
+/**
+ * xorshift32: deterministic, so two builds measure the same workload
+ */
+static uint32_t bench_rand(void)
+{
+    uint32_t x = bench_rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench_rand_state = x;
+    return x;
+}
+
+/**
+ * Sort the sample buffer and stream one result line.
+ * @param name scenario name for the log
+ * @param cnt number of valid samples
+ */
+static void bench_report(const char * name, uint32_t cnt)
+{
+    /*Insertion sort: the buffer is small and this avoids stdlib qsort*/
+    uint32_t i;
+    for(i = 1; i < cnt; i++) {
+        uint32_t v = bench_samples[i];
+        uint32_t j = i;
+        while(j > 0 && bench_samples[j - 1] > v) {
+            bench_samples[j] = bench_samples[j - 1];
+            j--;
+        }
+        bench_samples[j] = v;
+    }
+
+    char line[96];
+    int len = snprintf(line, sizeof(line), "%-24s min=%lu med=%lu p99=%lu\r\n",
+                       name,
+                       (unsigned long)bench_samples[0],
+                       (unsigned long)bench_samples[cnt / 2],
+                       (unsigned long)bench_samples[(cnt * 99) / 100]);
+    if(len <= 0) return;
+
+    /*Blocking on purpose: a benchmark must not lose lines to a full ring*/
+    while(os_uart_tx_free() < (size_t)len);
+    os_uart_write(line, (size_t)len);
+}
+
+/**
+ * Time os_mem_alloc and os_mem_free separately for one size
+ * @param size the allocation size in bytes
+ */
+static void bench_mem_alloc_free(size_t size)
+{
+    static void * ptrs[OS_BENCH_SAMPLE_CNT];
+    uint32_t i;
+
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        uint32_t t0 = bench_cycles();
+        ptrs[i] = os_mem_alloc(size);
+        bench_samples[i] = bench_cycles() - t0;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "os_mem_alloc %uB", (unsigned)size);
+    bench_report(name, OS_BENCH_SAMPLE_CNT);
+
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        uint32_t t0 = bench_cycles();
+        os_mem_free(ptrs[i]);
+        bench_samples[i] = bench_cycles() - t0;
+    }
+    snprintf(name, sizeof(name), "os_mem_free %uB", (unsigned)size);
+    bench_report(name, OS_BENCH_SAMPLE_CNT);
+}
+
+/**
+ * Time allocation on a deliberately fragmented heap: allocate blocks of
+ * mixed sizes, free every other one, then measure mid-size allocations
+ * that have to hunt through the holes.
+ */
+static void bench_mem_fragmented(void)
+{
+    static void * ptrs[BENCH_FRAG_BLOCK_CNT];
+    uint32_t i;
+
+    for(i = 0; i < BENCH_FRAG_BLOCK_CNT; i++) {
+        size_t size = 16 + (bench_rand() % 240);
+        ptrs[i] = os_mem_alloc(size);
+    }
+    for(i = 0; i < BENCH_FRAG_BLOCK_CNT; i += 2) {
+        os_mem_free(ptrs[i]);
+        ptrs[i] = NULL;
+    }
+
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        uint32_t t0 = bench_cycles();
+        void * p = os_mem_alloc(96);
+        bench_samples[i] = bench_cycles() - t0;
+        os_mem_free(p);
+    }
+    bench_report("os_mem_alloc 96B frag", OS_BENCH_SAMPLE_CNT);
+
+    for(i = 1; i < BENCH_FRAG_BLOCK_CNT; i += 2) os_mem_free(ptrs[i]);
+}
+
+/**
+ * Time _os_ll_ins_tail on a growing list and _os_ll_remove from its head
+ */
+static void bench_ll_ins_remove(void)
+{
+    os_ll_t ll;
+    uint32_t i;
+
+    _os_ll_init(&ll, 16);
+
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        uint32_t t0 = bench_cycles();
+        _os_ll_ins_tail(&ll);
+        bench_samples[i] = bench_cycles() - t0;
+    }
+    bench_report("os_ll_ins_tail", OS_BENCH_SAMPLE_CNT);
+
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        void * head = _os_ll_get_head(&ll);
+        uint32_t t0 = bench_cycles();
+        _os_ll_remove(&ll, head);
+        bench_samples[i] = bench_cycles() - t0;
+        os_mem_free(head);
+    }
+    bench_report("os_ll_remove", OS_BENCH_SAMPLE_CNT);
+}
+
+/**
+ * Time dense os_timer_handler passes: 32 period-1 timers are all ready on
+ * every tick, so each pass schedules and dispatches the lot.
+ */
+static void bench_timer_pass(void)
+{
+    static os_timer_t * timers[32];
+    uint32_t i;
+
+    for(i = 0; i < 32; i++) {
+        timers[i] = os_timer_create(bench_timer_noop_cb, 1, NULL);
+    }
+
+    uint32_t prev_tick = os_tick_get();
+    for(i = 0; i < OS_BENCH_SAMPLE_CNT; i++) {
+        while(os_tick_get() == prev_tick);  /*A fresh tick readies them all*/
+        prev_tick = os_tick_get();
+        uint32_t t0 = bench_cycles();
+        os_timer_handler();
+        bench_samples[i] = bench_cycles() - t0;
+    }
+    bench_report("os_timer_handler x32", OS_BENCH_SAMPLE_CNT);
+
+    for(i = 0; i < 32; i++) os_timer_del(timers[i]);
+}
+
+static void bench_timer_noop_cb(os_timer_t * timer)
+{
+    OS_UNUSED(timer);
+}
+
+#endif /*OS_USE_BENCH*/
@@ -0,0 +1,63 @@
+/**
+ * @file os_bench.h
+ * On-target microbenchmarks for the allocator, the linked lists and the
+ * timer handler. Build with OS_USE_BENCH 1 and call `os_bench_run()` once
+ * after init: each scenario streams min/median/p99 DWT cycle counts over
+ * USART2, so hot path regressions show up in the serial log instead of in
+ * the field.
+ */
+
+#ifndef OS_BENCH_H
+#define OS_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+/*********************
+ *      DEFINES
+ *********************/
+/*The benchmarks cost code size and run time: off unless asked for*/
+#ifndef OS_USE_BENCH
+#define OS_USE_BENCH 0
+#endif
+
+/*Timed repetitions per scenario. The sample buffer is
+ *4 * OS_BENCH_SAMPLE_CNT bytes of static data.*/
+#ifndef OS_BENCH_SAMPLE_CNT
+#define OS_BENCH_SAMPLE_CNT 128
+#endif
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+#if OS_USE_BENCH
+/**
+ * Run every benchmark scenario once and stream the results over USART2.
+ * Call it after `os_mem_init()`, `_os_timer_core_init()` and
+ * `os_uart_init()`; it restores the heap and the timer list before
+ * returning. Must run outside of timer context (the timer scenario calls
+ * `os_timer_handler()` itself and the report spin-waits on the TX ring):
+ * from a boot step, hand it over with `os_run_defer(os_bench_run)`.
+ */
+void os_bench_run(void);
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_BENCH_H*/
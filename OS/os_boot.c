@@ -0,0 +1,114 @@
+/**
+ * @file os_boot.c
+ * See os_boot.h. The pending steps form a singly linked list walked by a
+ * 0 period timer: every pass starts whatever became eligible and polls
+ * the ready checks, so several settle times elapse in parallel while the
+ * application already runs. The timer deletes itself with the last step.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_boot.h"
+#include "os_timer.h"
+#include <stddef.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void boot_timer_cb(os_timer_t * timer);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static os_boot_step_t * pending_head;
+static uint32_t registered_mask;
+static uint32_t done_mask;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Register a boot step
+ * @param step pointer to a statically allocated, filled-in step
+ */
+void os_boot_add_step(os_boot_step_t * step)
+{
+    step->started = 0;
+    step->next = pending_head;
+    pending_head = step;
+    registered_mask |= step->id;
+}
+
+/**
+ * Start working through the registered steps
+ */
+void os_boot_start(void)
+{
+    /*HIGH priority: the checks are a few cycles and the steps should not
+     *queue behind budget-bounded application timers (see os_timer.h)*/
+    os_timer_t * timer = os_timer_create(boot_timer_cb, 0, NULL);
+    os_timer_set_prio(timer, OS_TIMER_PRIO_HIGH);
+}
+
+/**
+ * Get the id bits of the completed steps
+ * @return the done mask
+ */
+uint32_t os_boot_done_mask(void)
+{
+    return done_mask;
+}
+
+/**
+ * Tell whether every registered step completed
+ * @return true: boot finished
+ */
+bool os_boot_done(void)
+{
+    return done_mask == registered_mask;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * One pass over the pending steps
+ * @param timer the driving timer; deleted when the last step finished
+ */
+static void boot_timer_cb(os_timer_t * timer)
+{
+    os_boot_step_t ** step_p = &pending_head;
+    while(*step_p) {
+        os_boot_step_t * step = *step_p;
+
+        if(!step->started && (done_mask & step->deps) == step->deps) {
+            if(step->start_cb) step->start_cb();
+            step->started = 1;
+        }
+
+        if(step->started && (step->ready_cb == NULL || step->ready_cb())) {
+            done_mask |= step->id;
+            *step_p = step->next; /*Unlink: the step is done*/
+            continue;
+        }
+
+        step_p = &step->next;
+    }
+
+    if(pending_head == NULL) os_timer_del(timer);
+}
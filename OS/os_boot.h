@@ -0,0 +1,96 @@
+/**
+ * @file os_boot.h
+ * Staged, dependency-ordered bring-up of the peripherals that do not
+ * belong on the cold boot critical path. Only the minimal clock + GPIO
+ * setup runs before `os_run()`; everything else is registered as a boot
+ * step and completes from `os_timer_handler()` passes, so an oscillator
+ * or PLL settle time is overlapped with application code instead of
+ * being spin-waited on.
+ *
+ * A step is a caller-allocated descriptor with a single id bit, a
+ * dependency mask of other steps' id bits, a `start_cb` that kicks the
+ * hardware off (runs once, when every dependency is done) and an
+ * optional `ready_cb` polled on every pass until the hardware settled.
+ * When it returns true the step is done and its dependents may start.
+ *
+ * Usage:
+ *    static os_boot_step_t uart_step = {
+ *        .id = BOOT_UART, .deps = 0, .start_cb = uart_boot_start,
+ *    };
+ *    os_boot_add_step(&uart_step);
+ *    ...
+ *    os_boot_start();
+ */
+
+#ifndef OS_BOOT_H
+#define OS_BOOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/**
+ * One deferred init step. Allocate it statically and fill `id`, `deps`,
+ * `start_cb` and optionally `ready_cb`; the rest is internal.
+ */
+typedef struct _os_boot_step_t {
+    uint32_t id;             /**< A single bit identifying the step*/
+    uint32_t deps;           /**< Id bits of the steps that must be done first*/
+    void (*start_cb)(void);  /**< Kicks the init off; NULL for a pure wait step*/
+    bool (*ready_cb)(void);  /**< Polled until true; NULL: done right after start*/
+    struct _os_boot_step_t * next; /**< Internal: the pending list link*/
+    uint8_t started;         /**< Internal: `start_cb` already ran*/
+} os_boot_step_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Register a boot step. Call it before `os_boot_start`.
+ * @param step pointer to a statically allocated, filled-in step
+ */
+void os_boot_add_step(os_boot_step_t * step);
+
+/**
+ * Start working through the registered steps: creates a high priority
+ * 0 period timer that starts every step whose dependencies are done and
+ * polls the ready checks, then deletes itself when all steps finished.
+ */
+void os_boot_start(void);
+
+/**
+ * Get the id bits of the completed steps
+ * @return the done mask
+ */
+uint32_t os_boot_done_mask(void);
+
+/**
+ * Tell whether every registered step completed
+ * @return true: boot finished
+ */
+bool os_boot_done(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_BOOT_H*/
@@ -0,0 +1,68 @@
+/**
+ * @file os_event.c
+ * See os_event.h. The whole module is one word: setting is an atomic OR
+ * from any interrupt priority, consuming is an atomic exchange with 0 in
+ * the timer handler, so no critical section is needed on either side and
+ * events posted during a take land in the next pass instead of being lost.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_event.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static uint32_t event_flags;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Post events. Safe from any interrupt: it is one atomic OR.
+ * @param bits the event bits to set
+ */
+void os_event_set(uint32_t bits)
+{
+    __atomic_fetch_or(&event_flags, bits, __ATOMIC_RELEASE);
+}
+
+/**
+ * Peek at the pending events without consuming them
+ * @return the currently set event bits
+ */
+uint32_t os_event_get(void)
+{
+    return __atomic_load_n(&event_flags, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Consume every pending event. Called by `os_timer_handler()`.
+ * @return the event bits that were set
+ */
+uint32_t _os_event_take(void)
+{
+    return __atomic_exchange_n(&event_flags, 0, __ATOMIC_ACQUIRE);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
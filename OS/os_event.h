@@ -0,0 +1,64 @@
+/**
+ * @file os_event.h
+ * A 32 bit atomic event-flag word between interrupts and the timer
+ * handler. An ISR posts an event with a single atomic OR; the next
+ * `os_timer_handler()` pass consumes the word and readies only the
+ * timers bound to the set bits with `os_timer_bind_event()`. This
+ * replaces the 1 ms polling timers that watched ad-hoc volatile flags:
+ * reaction latency stays "next handler entry", the no-op dispatches go.
+ */
+
+#ifndef OS_EVENT_H
+#define OS_EVENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Post events. Safe from any interrupt: it is one atomic OR.
+ * The bit assignment is the application's business (e.g. bit 0 = WiFi
+ * data ready, bit 1 = SD detect edge, bit 2 = touch interrupt).
+ * @param bits the event bits to set
+ */
+void os_event_set(uint32_t bits);
+
+/**
+ * Peek at the pending events without consuming them
+ * @return the currently set event bits
+ */
+uint32_t os_event_get(void);
+
+/**
+ * Consume every pending event. Called by `os_timer_handler()`; not
+ * intended for application code.
+ * @return the event bits that were set
+ */
+uint32_t _os_event_take(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_EVENT_H*/
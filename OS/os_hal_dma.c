@@ -0,0 +1,280 @@
+/**
+ * @file os_hal_dma.c
+ * MDMA backed memory-to-memory transfers for the STM32H7.
+ * The registers are addressed directly so the module stays independent of
+ * the HAL; only channel 0 is used.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_hal_dma.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*MDMA channel 0 register block (RM0455)*/
+#define MDMA_BASE 0x52000000UL
+#define MDMA_C0 (MDMA_BASE + 0x40UL)
+#define MDMA_C0ISR   (*(volatile uint32_t *)(MDMA_C0 + 0x00UL))
+#define MDMA_C0IFCR  (*(volatile uint32_t *)(MDMA_C0 + 0x04UL))
+#define MDMA_C0CR    (*(volatile uint32_t *)(MDMA_C0 + 0x0CUL))
+#define MDMA_C0TCR   (*(volatile uint32_t *)(MDMA_C0 + 0x10UL))
+#define MDMA_C0BNDTR (*(volatile uint32_t *)(MDMA_C0 + 0x14UL))
+#define MDMA_C0SAR   (*(volatile uint32_t *)(MDMA_C0 + 0x18UL))
+#define MDMA_C0DAR   (*(volatile uint32_t *)(MDMA_C0 + 0x1CUL))
+#define MDMA_C0TBR   (*(volatile uint32_t *)(MDMA_C0 + 0x68UL))
+
+#define MDMA_CR_EN      (1UL << 0)
+#define MDMA_CR_CTCIE   (1UL << 4)  /*Channel transfer complete interrupt*/
+#define MDMA_CR_SWRQ    (1UL << 16) /*Software request*/
+#define MDMA_ISR_CTCIF  (1UL << 1)
+#define MDMA_IFCR_ALL   0x1FUL
+
+/*TCR: byte source/destination, both incrementing, 128 byte buffer
+ *transfers, block trigger, software request mode*/
+#define MDMA_TCR_SINC_INC  (2UL << 0)
+#define MDMA_TCR_DINC_INC  (2UL << 2)
+#define MDMA_TCR_TLEN_128  (127UL << 18)
+#define MDMA_TCR_TRGM_BLCK (2UL << 28)
+#define MDMA_TCR_SWRM      (1UL << 30)
+
+/*One block transfer moves at most 64 KB; longer requests are chunked from
+ *the completion interrupt*/
+#define MDMA_MAX_BLOCK 0x10000UL
+
+/*MDMA clock enable and interrupt (RCC AHB3, IRQ 122 on the STM32H7B3)*/
+#define RCC_AHB3ENR  (*(volatile uint32_t *)0x58024534UL)
+#define RCC_AHB3ENR_MDMAEN (1UL << 0)
+#define NVIC_ISER3   (*(volatile uint32_t *)0xE000E10CUL)
+#define MDMA_IRQN_BIT (1UL << (122U - 96U))
+
+/*Cortex-M7 cache maintenance by address (32 byte lines)*/
+#define SCB_DCCMVAC  (*(volatile uint32_t *)0xE000EF68UL) /*Clean*/
+#define SCB_DCIMVAC  (*(volatile uint32_t *)0xE000EF5CUL) /*Invalidate*/
+#define SCB_DCCIMVAC (*(volatile uint32_t *)0xE000EF70UL) /*Clean & invalidate*/
+#define CACHE_LINE 32UL
+
+#if defined(__arm__)
+#define OS_DSB() __asm volatile("dsb 0xF" ::: "memory")
+#else
+#define OS_DSB() do {} while(0) /*Host build: no barrier needed*/
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+#if OS_HAL_DMA_USE_MDMA
+static void dcache_clean(const void * addr, size_t len);
+static void dcache_clean_invalidate(const void * addr, size_t len);
+static void start_block(void);
+#endif
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+#if OS_HAL_DMA_USE_MDMA
+static volatile bool dma_busy;
+static os_hal_dma_done_cb_t dma_done_cb;
+static void * dma_user_data;
+static uint32_t dma_src;       /*Next source address (0 for fill)*/
+static uint32_t dma_dst;       /*Next destination address*/
+static size_t dma_remaining;   /*Bytes still to transfer*/
+static uint32_t dma_fill_word; /*Source pattern of a fill transfer*/
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Init the MDMA channel used for memory transfers.
+ * Enables the MDMA clock and its interrupt.
+ */
+void os_hal_dma_init(void)
+{
+#if OS_HAL_DMA_USE_MDMA
+    RCC_AHB3ENR |= RCC_AHB3ENR_MDMAEN;
+    NVIC_ISER3 = MDMA_IRQN_BIT;
+#endif
+}
+
+/**
+ * Check whether a transfer is in flight
+ * @return true: the channel is busy
+ */
+bool os_hal_dma_busy(void)
+{
+#if OS_HAL_DMA_USE_MDMA
+    return dma_busy;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Start an asynchronous memory copy on the MDMA.
+ * D-cache maintenance of both ranges is handled internally.
+ * @param dst destination buffer
+ * @param src source buffer
+ * @param len number of bytes to copy
+ * @param done_cb called from interrupt context when the copy finished (can be NULL)
+ * @param user_data passed to `done_cb`
+ * @return OS_RES_OK: started; OS_RES_INV: channel busy or MDMA disabled
+ */
+os_res_t os_hal_dma_copy(void * dst, const void * src, size_t len,
+                         os_hal_dma_done_cb_t done_cb, void * user_data)
+{
+#if OS_HAL_DMA_USE_MDMA
+    if(dma_busy || len == 0) return OS_RES_INV;
+
+    /*The MDMA reads and writes memory directly: push dirty source lines
+     *out and make sure no stale destination line is written back later*/
+    dcache_clean(src, len);
+    dcache_clean_invalidate(dst, len);
+
+    dma_busy      = true;
+    dma_done_cb   = done_cb;
+    dma_user_data = user_data;
+    dma_src       = (uint32_t)(os_uintptr_t)src;
+    dma_dst       = (uint32_t)(os_uintptr_t)dst;
+    dma_remaining = len;
+
+    start_block();
+    return OS_RES_OK;
+#else
+    OS_UNUSED(dst); OS_UNUSED(src); OS_UNUSED(len);
+    OS_UNUSED(done_cb); OS_UNUSED(user_data);
+    return OS_RES_INV;
+#endif
+}
+
+/**
+ * Start an asynchronous memory fill on the MDMA.
+ * @param dst destination buffer
+ * @param v value to set [0..255]
+ * @param len number of bytes to set
+ * @param done_cb called from interrupt context when the fill finished (can be NULL)
+ * @param user_data passed to `done_cb`
+ * @return OS_RES_OK: started; OS_RES_INV: channel busy or MDMA disabled
+ */
+os_res_t os_hal_dma_set(void * dst, uint8_t v, size_t len,
+                        os_hal_dma_done_cb_t done_cb, void * user_data)
+{
+#if OS_HAL_DMA_USE_MDMA
+    if(dma_busy || len == 0) return OS_RES_INV;
+
+    dcache_clean_invalidate(dst, len);
+
+    dma_busy      = true;
+    dma_done_cb   = done_cb;
+    dma_user_data = user_data;
+    dma_fill_word = (uint32_t)v * 0x01010101UL;
+    dma_src       = 0; /*Fill: source is `dma_fill_word`, not incremented*/
+    dma_dst       = (uint32_t)(os_uintptr_t)dst;
+    dma_remaining = len;
+
+    /*The MDMA reads the pattern from RAM: push it out of the D-cache*/
+    dcache_clean(&dma_fill_word, sizeof(dma_fill_word));
+
+    start_block();
+    return OS_RES_OK;
+#else
+    OS_UNUSED(dst); OS_UNUSED(v); OS_UNUSED(len);
+    OS_UNUSED(done_cb); OS_UNUSED(user_data);
+    return OS_RES_INV;
+#endif
+}
+
+/**
+ * Call it from MDMA_IRQHandler. Continues chunked transfers and fires the
+ * completion callback.
+ */
+void os_hal_dma_irq_handler(void)
+{
+#if OS_HAL_DMA_USE_MDMA
+    if((MDMA_C0ISR & MDMA_ISR_CTCIF) == 0) return;
+    MDMA_C0IFCR = MDMA_IFCR_ALL;
+
+    if(dma_remaining) {
+        start_block(); /*Next chunk of a transfer longer than one block*/
+        return;
+    }
+
+    MDMA_C0CR = 0;
+    dma_busy = false;
+    if(dma_done_cb) dma_done_cb(dma_user_data);
+#endif
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#if OS_HAL_DMA_USE_MDMA
+
+/**
+ * Clean the D-cache lines covering a range (write dirty data to memory)
+ */
+static void dcache_clean(const void * addr, size_t len)
+{
+    uint32_t a = (uint32_t)(os_uintptr_t)addr & ~(CACHE_LINE - 1);
+    uint32_t end = (uint32_t)(os_uintptr_t)addr + len;
+    OS_DSB();
+    for(; a < end; a += CACHE_LINE) SCB_DCCMVAC = a;
+    OS_DSB();
+}
+
+/**
+ * Clean and invalidate the D-cache lines covering a range
+ */
+static void dcache_clean_invalidate(const void * addr, size_t len)
+{
+    uint32_t a = (uint32_t)(os_uintptr_t)addr & ~(CACHE_LINE - 1);
+    uint32_t end = (uint32_t)(os_uintptr_t)addr + len;
+    OS_DSB();
+    for(; a < end; a += CACHE_LINE) SCB_DCCIMVAC = a;
+    OS_DSB();
+}
+
+/**
+ * Program and software-trigger the next (up to 64 KB) block
+ */
+static void start_block(void)
+{
+    size_t block = dma_remaining > MDMA_MAX_BLOCK ? MDMA_MAX_BLOCK : dma_remaining;
+
+    MDMA_C0CR = 0; /*Disable before re-programming*/
+    MDMA_C0IFCR = MDMA_IFCR_ALL;
+
+    uint32_t tcr = MDMA_TCR_DINC_INC | MDMA_TCR_TLEN_128 |
+                   MDMA_TCR_TRGM_BLCK | MDMA_TCR_SWRM;
+    if(dma_src) {
+        tcr |= MDMA_TCR_SINC_INC;
+        MDMA_C0SAR = dma_src;
+        dma_src += block;
+    }
+    else {
+        MDMA_C0SAR = (uint32_t)(os_uintptr_t)&dma_fill_word; /*Fixed source*/
+    }
+    MDMA_C0TCR = tcr;
+    MDMA_C0TBR = 0;
+    MDMA_C0DAR = dma_dst;
+    MDMA_C0BNDTR = block;
+
+    dma_dst += block;
+    dma_remaining -= block;
+
+    MDMA_C0CR = MDMA_CR_CTCIE | MDMA_CR_EN;
+    MDMA_C0CR |= MDMA_CR_SWRQ;
+}
+
+#endif /*OS_HAL_DMA_USE_MDMA*/
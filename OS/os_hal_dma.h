@@ -0,0 +1,96 @@
+/**
+ * @file os_hal_dma.h
+ * MDMA backed memory-to-memory transfers for the STM32H7.
+ * Used by `os_memcpy`/`os_memset` for large blocks so the core is free to
+ * run timers while the peripheral moves the data.
+ */
+
+#ifndef OS_HAL_DMA_H
+#define OS_HAL_DMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Master switch. Enabling it requires the MDMA clock and interrupt, see
+ *`os_hal_dma_init` and MDMA_IRQHandler in Src/stm32h7xx_it.c.*/
+#ifndef OS_HAL_DMA_USE_MDMA
+#define OS_HAL_DMA_USE_MDMA 0
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Called when an asynchronous transfer finished.
+ */
+typedef void (*os_hal_dma_done_cb_t)(void * user_data);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Init the MDMA channel used for memory transfers.
+ * Enables the MDMA clock and its interrupt.
+ */
+void os_hal_dma_init(void);
+
+/**
+ * Check whether a transfer is in flight
+ * @return true: the channel is busy
+ */
+bool os_hal_dma_busy(void);
+
+/**
+ * Start an asynchronous memory copy on the MDMA.
+ * D-cache maintenance of both ranges is handled internally.
+ * @param dst destination buffer
+ * @param src source buffer
+ * @param len number of bytes to copy
+ * @param done_cb called from interrupt context when the copy finished (can be NULL)
+ * @param user_data passed to `done_cb`
+ * @return OS_RES_OK: started; OS_RES_INV: channel busy or MDMA disabled
+ */
+os_res_t os_hal_dma_copy(void * dst, const void * src, size_t len,
+                         os_hal_dma_done_cb_t done_cb, void * user_data);
+
+/**
+ * Start an asynchronous memory fill on the MDMA.
+ * @param dst destination buffer
+ * @param v value to set [0..255]
+ * @param len number of bytes to set
+ * @param done_cb called from interrupt context when the fill finished (can be NULL)
+ * @param user_data passed to `done_cb`
+ * @return OS_RES_OK: started; OS_RES_INV: channel busy or MDMA disabled
+ */
+os_res_t os_hal_dma_set(void * dst, uint8_t v, size_t len,
+                        os_hal_dma_done_cb_t done_cb, void * user_data);
+
+/**
+ * Call it from MDMA_IRQHandler. Continues chunked transfers and fires the
+ * completion callback.
+ */
+void os_hal_dma_irq_handler(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_HAL_DMA_H*/
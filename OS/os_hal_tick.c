@@ -1,17 +1,25 @@
 /**
  * @file os_hal_tick.c
- * Provide access to the system tick with 1 millisecond resolution
+ * Provide access to the system tick with 1 millisecond resolution and to
+ * the DWT cycle counter with microsecond (cycle) resolution
  */
 
 /*********************
  *      INCLUDES
  *********************/
 #include "os_hal_tick.h"
+#include "os_trace.h"
 #include <stddef.h>
 
 /*********************
  *      DEFINES
  *********************/
+/*Cortex-M7 DWT cycle counter*/
+#define DWT_CTRL   (*(volatile uint32_t *)0xE0001000UL)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004UL)
+#define DEMCR      (*(volatile uint32_t *)0xE000EDFCUL)
+#define DEMCR_TRCENA       (1UL << 24)
+#define DWT_CTRL_CYCCNTENA (1UL << 0)
 
 /**********************
  *      TYPEDEFS
@@ -24,8 +32,14 @@
 /**********************
  *  STATIC VARIABLES
  **********************/
-  static uint32_t sys_time = 0;
-  static volatile uint8_t tick_irq_flag;
+static volatile uint32_t sys_time = 0;
+
+#if defined(__arm__)
+/*Software extension of the 32 bit cycle counter to 64 bits.
+ *Written only from thread context, see `os_tick_get_cycles`.*/
+static uint32_t cycles_last = 0;
+static uint32_t cycles_hi   = 0;
+#endif
 /**********************
  *      MACROS
  **********************/
@@ -34,13 +48,24 @@
  *   GLOBAL FUNCTIONS
  **********************/
 
+/**
+ * Init the tick module: start the free running DWT cycle counter
+ */
+void _os_tick_core_init(void)
+{
+#if defined(__arm__)
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
 /**
  * You have to call this function periodically
  * @param tick_period the call period of this function in milliseconds
  */
 void os_tick_inc(uint32_t tick_period)
 {
-    tick_irq_flag = 0;
     sys_time += tick_period;
 }
 
@@ -51,34 +76,54 @@ void os_tick_inc(uint32_t tick_period)
  */
 uint32_t os_tick_get(void)
 {
-    uint32_t result;
-    do {
-        tick_irq_flag = 1;
-        result        = sys_time;
-    } while(!tick_irq_flag); /*Continue until see a non interrupted cycle*/
-
-    return result;
+    /*An aligned 32 bit read is atomic on the Cortex-M, so a tick interrupt
+     *cannot tear it: no retry loop is needed*/
+    return sys_time;
 }
 
 /**
  * Get the elapsed milliseconds since a previous time stamp
- * @param prev_tick a previous time stamp (return value of lv_tick_get() )
+ * @param prev_tick a previous time stamp (return value of os_tick_get() )
  * @return the elapsed milliseconds since 'prev_tick'
  */
 uint32_t os_tick_elaps(uint32_t prev_tick)
 {
-    uint32_t act_time = os_tick_get();
+    /*Unsigned subtraction gives the right result across wrap around too*/
+    return os_tick_get() - prev_tick;
+}
 
-    /*If there is no overflow in sys_time simple subtract*/
-    if(act_time >= prev_tick) {
-        prev_tick = act_time - prev_tick;
-    }
-    else {
-        prev_tick = UINT32_MAX - prev_tick + 1;
-        prev_tick += act_time;
+/**
+ * Get the elapsed CPU cycles since start up from the DWT cycle counter,
+ * extended to 64 bits in software.
+ * Call it from thread context only and at least once per counter wrap
+ * (~15 s at 280 MHz); the per-timer statistics of `os_timer_handler()`
+ * satisfy this in practice.
+ * @return the elapsed CPU cycles
+ */
+uint64_t os_tick_get_cycles(void)
+{
+#if defined(__arm__)
+    uint32_t now = DWT_CYCCNT;
+    if(now < cycles_last) { /*The 32 bit counter wrapped*/
+        cycles_hi++;
+        /*Lets the trace decoder extend the 32 bit time stamps to 64 bits*/
+        OS_TRACE_ADD(OS_TRACE_EVT_CYCLE_WRAP, cycles_hi);
     }
+    cycles_last = now;
+    return ((uint64_t)cycles_hi << 32) | now;
+#else
+    /*Off-target: derive the cycles from the ms tick*/
+    return (uint64_t)sys_time * (OS_TICK_CPU_CLOCK_MHZ * 1000ULL);
+#endif
+}
 
-    return prev_tick;
+/**
+ * Get the elapsed microseconds since start up
+ * @return the elapsed microseconds
+ */
+uint64_t os_tick_get_us(void)
+{
+    return os_tick_get_cycles() / OS_TICK_CPU_CLOCK_MHZ;
 }
 
 /**********************
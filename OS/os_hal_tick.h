@@ -1,6 +1,7 @@
 /**
  * @file os_hal_tick.h
- * Provide access to the system tick with 1 millisecond resolution
+ * Provide access to the system tick with 1 millisecond resolution and to
+ * the DWT cycle counter with microsecond (cycle) resolution
  */
 
 #ifndef OS_HAL_TICK_H
@@ -19,6 +20,11 @@ extern "C" {
 /*********************
  *      DEFINES
  *********************/
+/*Core clock in MHz, i.e. CPU cycles per microsecond. The default is the
+ *STM32H7B3 running at full speed.*/
+#ifndef OS_TICK_CPU_CLOCK_MHZ
+#define OS_TICK_CPU_CLOCK_MHZ 280
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -28,6 +34,12 @@ extern "C" {
  * GLOBAL PROTOTYPES
  **********************/
 
+/**
+ * Init the tick module: start the free running DWT cycle counter.
+ * Called by `_os_timer_core_init`.
+ */
+void _os_tick_core_init(void);
+
 /**
  * You have to call this function periodically
  * @param tick_period the call period of this function in milliseconds
@@ -48,6 +60,21 @@ uint32_t os_tick_get(void);
  */
 uint32_t os_tick_elaps(uint32_t prev_tick);
 
+/**
+ * Get the elapsed CPU cycles since start up from the DWT cycle counter,
+ * extended to 64 bits in software.
+ * Call it from thread context only and at least once per counter wrap
+ * (~15 s at 280 MHz).
+ * @return the elapsed CPU cycles
+ */
+uint64_t os_tick_get_cycles(void);
+
+/**
+ * Get the elapsed microseconds since start up
+ * @return the elapsed microseconds
+ */
+uint64_t os_tick_get_us(void);
+
 /**********************
  *      MACROS
  **********************/
@@ -0,0 +1,184 @@
+/**
+ * @file os_hrtimer.c
+ * One-shot microsecond timers on TIM2 compare channel 1.
+ * TIM2 is a 32 bit counter on APB1, free running at 1 MHz: an absolute
+ * deadline fits directly into CCR1 and wraps only after ~71 minutes.
+ * The pending timers form a singly linked list sorted at insert, so the
+ * interrupt only ever looks at the head.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_hrtimer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+/*TIM2 registers (RM0455)*/
+#define TIM2_BASE 0x40000000UL
+#define TIM2_CR1  (*(volatile uint32_t *)(TIM2_BASE + 0x00UL))
+#define TIM2_DIER (*(volatile uint32_t *)(TIM2_BASE + 0x0CUL))
+#define TIM2_SR   (*(volatile uint32_t *)(TIM2_BASE + 0x10UL))
+#define TIM2_EGR  (*(volatile uint32_t *)(TIM2_BASE + 0x14UL))
+#define TIM2_CNT  (*(volatile uint32_t *)(TIM2_BASE + 0x24UL))
+#define TIM2_PSC  (*(volatile uint32_t *)(TIM2_BASE + 0x28UL))
+#define TIM2_ARR  (*(volatile uint32_t *)(TIM2_BASE + 0x2CUL))
+#define TIM2_CCR1 (*(volatile uint32_t *)(TIM2_BASE + 0x34UL))
+
+#define TIM_CR1_CEN    (1UL << 0)
+#define TIM_DIER_CC1IE (1UL << 1)
+#define TIM_SR_CC1IF   (1UL << 1)
+#define TIM_EGR_UG     (1UL << 0)
+
+/*TIM2 clock enable and interrupt (IRQ 28)*/
+#define RCC_APB1LENR (*(volatile uint32_t *)0x580244E8UL)
+#define RCC_APB1LENR_TIM2EN (1UL << 0)
+#define NVIC_ISER0 (*(volatile uint32_t *)0xE000E100UL)
+#define NVIC_ISPR0 (*(volatile uint32_t *)0xE000E200UL)
+#define TIM2_IRQN_BIT (1UL << 28)
+
+#if defined(__arm__)
+#define OS_HRTIMER_ENTER_CRITICAL() \
+    uint32_t _primask;              \
+    __asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(_primask))
+#define OS_HRTIMER_EXIT_CRITICAL() __asm volatile("msr primask, %0" :: "r"(_primask))
+#else
+#define OS_HRTIMER_ENTER_CRITICAL() do {} while(0)
+#define OS_HRTIMER_EXIT_CRITICAL()  do {} while(0)
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void hrtimer_unlink(os_hrtimer_t * timer);
+static void hrtimer_program_head(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+/*Pending timers, soonest deadline first. Modified only with the TIM2
+ *interrupt masked.*/
+static os_hrtimer_t * hrtimer_head;
+
+/**********************
+ *      MACROS
+ **********************/
+/*Signed distance handles the counter wrap*/
+#define DEADLINE_PASSED(dl) ((int32_t)((dl) - TIM2_CNT) <= 0)
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void os_hrtimer_init(void)
+{
+    hrtimer_head = NULL;
+
+    RCC_APB1LENR |= RCC_APB1LENR_TIM2EN;
+    (void)RCC_APB1LENR; /*Read back: let the clock settle*/
+
+    TIM2_CR1 = 0;
+    TIM2_PSC = (OS_HRTIMER_TIM_CLOCK_HZ / 1000000UL) - 1UL;
+    TIM2_ARR = 0xFFFFFFFFUL;
+    TIM2_EGR = TIM_EGR_UG;     /*Load PSC, reset CNT*/
+    TIM2_SR  = 0;              /*UG also sets UIF: clear everything*/
+    TIM2_DIER = TIM_DIER_CC1IE;
+    TIM2_CR1 = TIM_CR1_CEN;
+
+    NVIC_ISER0 = TIM2_IRQN_BIT;
+}
+
+void os_hrtimer_start(os_hrtimer_t * timer, uint32_t delay_us,
+                      os_hrtimer_cb_t cb, void * user_data)
+{
+    OS_HRTIMER_ENTER_CRITICAL();
+
+    if(timer->active) hrtimer_unlink(timer);
+
+    timer->cb = cb;
+    timer->user_data = user_data;
+    timer->deadline = TIM2_CNT + delay_us;
+    timer->active = 1;
+
+    /*Insert sorted: walk to the last pending timer that is due earlier*/
+    os_hrtimer_t ** insert_at = &hrtimer_head;
+    while(*insert_at && (int32_t)((*insert_at)->deadline - timer->deadline) <= 0) {
+        insert_at = &(*insert_at)->next;
+    }
+    timer->next = *insert_at;
+    *insert_at = timer;
+
+    if(hrtimer_head == timer) hrtimer_program_head();
+
+    OS_HRTIMER_EXIT_CRITICAL();
+}
+
+void os_hrtimer_cancel(os_hrtimer_t * timer)
+{
+    OS_HRTIMER_ENTER_CRITICAL();
+
+    if(timer->active) {
+        bool was_head = hrtimer_head == timer;
+        hrtimer_unlink(timer);
+        if(was_head && hrtimer_head) hrtimer_program_head();
+    }
+
+    OS_HRTIMER_EXIT_CRITICAL();
+}
+
+uint32_t os_hrtimer_now_us(void)
+{
+    return TIM2_CNT;
+}
+
+void os_hrtimer_irq_handler(void)
+{
+    TIM2_SR = (uint32_t)~TIM_SR_CC1IF; /*rc_w0: writing 0 clears, 1 leaves alone*/
+
+    /*Fire everything that is due; the callbacks may re-arm timers so
+     *always re-read the head*/
+    while(hrtimer_head && DEADLINE_PASSED(hrtimer_head->deadline)) {
+        os_hrtimer_t * timer = hrtimer_head;
+        hrtimer_head = timer->next;
+        timer->active = 0;
+        timer->cb(timer);
+    }
+
+    if(hrtimer_head) hrtimer_program_head();
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Remove a timer from the pending list. Call with the interrupt masked.
+ * @param timer an active timer
+ */
+static void hrtimer_unlink(os_hrtimer_t * timer)
+{
+    os_hrtimer_t ** at = &hrtimer_head;
+    while(*at && *at != timer) at = &(*at)->next;
+    if(*at) *at = timer->next;
+    timer->active = 0;
+}
+
+/**
+ * Program CCR1 for the head of the pending list. If the deadline raced
+ * past the counter meanwhile the compare event would be missed, so pend
+ * the interrupt by hand.
+ */
+static void hrtimer_program_head(void)
+{
+    TIM2_CCR1 = hrtimer_head->deadline;
+    if(DEADLINE_PASSED(hrtimer_head->deadline)) {
+        NVIC_ISPR0 = TIM2_IRQN_BIT;
+    }
+}
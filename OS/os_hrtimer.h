@@ -0,0 +1,104 @@
+/**
+ * @file os_hrtimer.h
+ * One-shot high resolution (microsecond) timers backed by a hardware TIM
+ * compare channel. The callbacks fire from the TIM interrupt with bounded
+ * jitter, independent of how long the current `os_timer_handler()` pass
+ * takes. Use `os_timer_create()` for ms-scale cooperative work; this
+ * module covers what that physically cannot.
+ */
+
+#ifndef OS_HRTIMER_H
+#define OS_HRTIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Kernel clock of the TIM used (TIM2 on APB1), to derive the 1 MHz tick*/
+#ifndef OS_HRTIMER_TIM_CLOCK_HZ
+#define OS_HRTIMER_TIM_CLOCK_HZ 280000000UL
+#endif
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+struct _os_hrtimer_t;
+
+/**
+ * High resolution timers execute this type of function, in interrupt
+ * context: keep it short, defer with `os_work_submit` if needed.
+ */
+typedef void (*os_hrtimer_cb_t)(struct _os_hrtimer_t *);
+
+/**
+ * Descriptor of a high resolution one-shot timer.
+ * Allocated by the caller (typically static), so arming one never
+ * touches the heap.
+ */
+typedef struct _os_hrtimer_t {
+    os_hrtimer_cb_t cb;              /**< Called when the deadline fires*/
+    void * user_data;                /**< Custom user data*/
+    uint32_t deadline;               /**< Absolute time of expiry in us ticks*/
+    struct _os_hrtimer_t * next;     /**< Next pending timer, deadline ordered*/
+    uint8_t active;                  /**< Non-zero while armed*/
+} os_hrtimer_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Init the os_hrtimer module: start TIM2 free running at 1 MHz and enable
+ * its compare interrupt.
+ */
+void os_hrtimer_init(void);
+
+/**
+ * Arm a one-shot timer. Re-arming an active timer moves its deadline.
+ * Safe from thread and interrupt context.
+ * @param timer pointer to a caller-allocated os_hrtimer_t
+ * @param delay_us the delay in microseconds (50..500 us is the design
+ *                 range; longer delays work but belong to os_timer)
+ * @param cb called from the TIM interrupt when the delay elapsed
+ * @param user_data custom parameter stored in the timer
+ */
+void os_hrtimer_start(os_hrtimer_t * timer, uint32_t delay_us,
+                      os_hrtimer_cb_t cb, void * user_data);
+
+/**
+ * Disarm a timer. Its callback will not be called.
+ * Safe to call on an inactive timer.
+ * @param timer pointer to an os_hrtimer_t
+ */
+void os_hrtimer_cancel(os_hrtimer_t * timer);
+
+/**
+ * Get the current time of the hardware counter
+ * @return the elapsed microseconds (wraps after ~71 minutes)
+ */
+uint32_t os_hrtimer_now_us(void);
+
+/**
+ * Call it from TIM2_IRQHandler: fires the due timers and programs the
+ * compare channel for the next deadline.
+ */
+void os_hrtimer_irq_handler(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_HRTIMER_H*/
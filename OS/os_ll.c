@@ -58,7 +58,7 @@ void _os_ll_init(os_ll_t * ll_p, uint32_t node_size)
  * @param ll_p pointer to linked list
  * @return pointer to the new head
  */
-void * _os_ll_ins_head(os_ll_t * ll_p)
+OS_HOT_FUNC void * _os_ll_ins_head(os_ll_t * ll_p)
 {
 	os_ll_node_t * n_new;
 
@@ -117,7 +117,7 @@ void * _os_ll_ins_prev(os_ll_t * ll_p, void * n_act)
  * @param ll_p pointer to linked list
  * @return pointer to the new tail
  */
-void * _os_ll_ins_tail(os_ll_t * ll_p)
+OS_HOT_FUNC void * _os_ll_ins_tail(os_ll_t * ll_p)
 {
 	os_ll_node_t * n_new;
 
@@ -145,7 +145,7 @@ void * _os_ll_ins_tail(os_ll_t * ll_p)
  * @param ll_p pointer to the linked list of 'node_p'
  * @param node_p pointer to node in 'll_p' linked list
  */
-void _os_ll_remove(os_ll_t * ll_p, void * node_p)
+OS_HOT_FUNC void _os_ll_remove(os_ll_t * ll_p, void * node_p)
 {
     if(ll_p == NULL) return;
 
@@ -247,7 +247,7 @@ void _os_ll_chg_list(os_ll_t * ll_ori_p, os_ll_t * ll_new_p, void * node, bool h
  * @param ll_p pointer to linked list
  * @return pointer to the head of 'll_p'
  */
-void * _os_ll_get_head(const os_ll_t * ll_p)
+OS_HOT_FUNC void * _os_ll_get_head(const os_ll_t * ll_p)
 {
     if(ll_p == NULL) return NULL;
     return ll_p->head;
@@ -270,7 +270,7 @@ void * _os_ll_get_tail(const os_ll_t * ll_p)
  * @param n_act pointer a node
  * @return pointer to the next node
  */
-void * _os_ll_get_next(const os_ll_t * ll_p, const void * n_act)
+OS_HOT_FUNC void * _os_ll_get_next(const os_ll_t * ll_p, const void * n_act)
 {
     /*Pointer to the next node is stored in the end of this node.
      *Go there and return the address found there*/
@@ -359,6 +359,115 @@ bool _os_ll_is_empty(os_ll_t * ll_p)
     return false;
 }
 
+/**
+ * Initialize an intrusive linked list
+ * @param ll_p pointer to os_ll_intr_t variable
+ */
+void _os_ll_intr_init(os_ll_intr_t * ll_p)
+{
+    ll_p->head = NULL;
+    ll_p->tail = NULL;
+}
+
+/**
+ * Link a node as the new head of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @param node pointer to the link fields embedded in the caller's structure
+ */
+OS_HOT_FUNC void _os_ll_intr_ins_head(os_ll_intr_t * ll_p, os_ll_intr_node_t * node)
+{
+    node->prev = NULL;
+    node->next = ll_p->head;
+
+    if(ll_p->head != NULL) ll_p->head->prev = node;
+
+    ll_p->head = node;
+    if(ll_p->tail == NULL) ll_p->tail = node; /*First node: it's the tail too*/
+}
+
+/**
+ * Link a node as the new tail of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @param node pointer to the link fields embedded in the caller's structure
+ */
+OS_HOT_FUNC void _os_ll_intr_ins_tail(os_ll_intr_t * ll_p, os_ll_intr_node_t * node)
+{
+    node->next = NULL;
+    node->prev = ll_p->tail;
+
+    if(ll_p->tail != NULL) ll_p->tail->next = node;
+
+    ll_p->tail = node;
+    if(ll_p->head == NULL) ll_p->head = node; /*First node: it's the head too*/
+}
+
+/**
+ * Unlink a node from an intrusive list. The node's memory is not touched.
+ * @param ll_p pointer to the linked list of `node`
+ * @param node pointer to a linked node
+ */
+OS_HOT_FUNC void _os_ll_intr_remove(os_ll_intr_t * ll_p, os_ll_intr_node_t * node)
+{
+    if(node->prev) node->prev->next = node->next;
+    else ll_p->head = node->next;
+
+    if(node->next) node->next->prev = node->prev;
+    else ll_p->tail = node->prev;
+
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+/**
+ * Return with the head node of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @return pointer to the head or NULL if the list is empty
+ */
+os_ll_intr_node_t * _os_ll_intr_get_head(const os_ll_intr_t * ll_p)
+{
+    if(ll_p == NULL) return NULL;
+    return ll_p->head;
+}
+
+/**
+ * Return with the tail node of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @return pointer to the tail or NULL if the list is empty
+ */
+os_ll_intr_node_t * _os_ll_intr_get_tail(const os_ll_intr_t * ll_p)
+{
+    if(ll_p == NULL) return NULL;
+    return ll_p->tail;
+}
+
+/**
+ * Return the length of an intrusive linked list.
+ * @param ll_p pointer to the linked list
+ * @return length of the linked list
+ */
+uint32_t _os_ll_intr_get_len(const os_ll_intr_t * ll_p)
+{
+    uint32_t len = 0;
+    os_ll_intr_node_t * node;
+
+    for(node = ll_p->head; node != NULL; node = node->next) {
+        len++;
+    }
+
+    return len;
+}
+
+/**
+ * Check if an intrusive linked list is empty
+ * @param ll_p pointer to the linked list
+ * @return true: the linked list is empty; false: not empty
+ */
+bool _os_ll_intr_is_empty(const os_ll_intr_t * ll_p)
+{
+    if(ll_p == NULL) return true;
+    return ll_p->head == NULL;
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -35,6 +35,19 @@ typedef struct {
     os_ll_node_t * tail;
 } os_ll_t;
 
+/** Link fields of an intrusive list. Embed it into the listed structure;
+ * the list never allocates, (un)linking is pure pointer surgery.*/
+typedef struct _os_ll_intr_node_t {
+    struct _os_ll_intr_node_t * prev;
+    struct _os_ll_intr_node_t * next;
+} os_ll_intr_node_t;
+
+/** Description of an intrusive linked list*/
+typedef struct {
+    os_ll_intr_node_t * head;
+    os_ll_intr_node_t * tail;
+} os_ll_intr_t;
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -152,6 +165,61 @@ void _os_ll_move_before(os_ll_t * ll_p, void * n_act, void * n_after);
  */
 bool _os_ll_is_empty(os_ll_t * ll_p);
 
+/**
+ * Initialize an intrusive linked list
+ * @param ll_p pointer to os_ll_intr_t variable
+ */
+void _os_ll_intr_init(os_ll_intr_t * ll_p);
+
+/**
+ * Link a node as the new head of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @param node pointer to the link fields embedded in the caller's structure
+ */
+void _os_ll_intr_ins_head(os_ll_intr_t * ll_p, os_ll_intr_node_t * node);
+
+/**
+ * Link a node as the new tail of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @param node pointer to the link fields embedded in the caller's structure
+ */
+void _os_ll_intr_ins_tail(os_ll_intr_t * ll_p, os_ll_intr_node_t * node);
+
+/**
+ * Unlink a node from an intrusive list. The node's memory is not touched.
+ * @param ll_p pointer to the linked list of `node`
+ * @param node pointer to a linked node
+ */
+void _os_ll_intr_remove(os_ll_intr_t * ll_p, os_ll_intr_node_t * node);
+
+/**
+ * Return with the head node of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @return pointer to the head or NULL if the list is empty
+ */
+os_ll_intr_node_t * _os_ll_intr_get_head(const os_ll_intr_t * ll_p);
+
+/**
+ * Return with the tail node of an intrusive list
+ * @param ll_p pointer to the linked list
+ * @return pointer to the tail or NULL if the list is empty
+ */
+os_ll_intr_node_t * _os_ll_intr_get_tail(const os_ll_intr_t * ll_p);
+
+/**
+ * Return the length of an intrusive linked list.
+ * @param ll_p pointer to the linked list
+ * @return length of the linked list
+ */
+uint32_t _os_ll_intr_get_len(const os_ll_intr_t * ll_p);
+
+/**
+ * Check if an intrusive linked list is empty
+ * @param ll_p pointer to the linked list
+ * @return true: the linked list is empty; false: not empty
+ */
+bool _os_ll_intr_is_empty(const os_ll_intr_t * ll_p);
+
 /**********************
  *      MACROS
  **********************/
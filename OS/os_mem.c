@@ -9,6 +9,8 @@
  *********************/
 #include "os_mem.h"
 #include "os_tlsf.h"
+#include "os_timer.h"
+#include "os_trace.h"
 
 /*********************
  *      DEFINES
@@ -17,26 +19,128 @@
 #define ALIGN_MASK       0x3
 #define ZERO_MEM_SENTINEL  0xa1b2c3d4
 
+/*Cortex-M7 D-cache maintenance by address, for the DMA buffers*/
+#define SCB_DCIMVAC  (*(volatile uint32_t *)0xE000EF5CUL) /*Invalidate*/
+#define SCB_DCCMVAC  (*(volatile uint32_t *)0xE000EF68UL) /*Clean*/
+
+#if defined(__arm__)
+#define OS_DSB() __asm volatile("dsb 0xF" ::: "memory")
+#define OS_MEM_ENTER_CRITICAL()                         \
+    uint32_t _primask;                                  \
+    __asm volatile("mrs %0, primask" : "=r"(_primask)); \
+    __asm volatile("cpsid i" ::: "memory")
+#define OS_MEM_EXIT_CRITICAL() \
+    __asm volatile("msr primask, %0" :: "r"(_primask) : "memory")
+#else
+#define OS_DSB() do {} while(0) /*Host build: no barrier needed*/
+#define OS_MEM_ENTER_CRITICAL()
+#define OS_MEM_EXIT_CRITICAL()
+#endif
+
+#if OS_MEM_USE_TAGS
+/*Set in the hidden header of `os_mem_alloc_dma` buffers: the payload sits
+ *a whole cache line after the raw block, not one header word*/
+#define MEM_HDR_DMA 0x100UL
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/**
+ * A memory region managed by its own TLSF instance.
+ */
+typedef struct {
+    os_tlsf_t tlsf;
+    os_pool_t tlsf_pool; /**< The TLSF pool handle of the region (differs from `base` when the control is out-of-band)*/
+    uint8_t * base;
+    size_t size;
+    uint8_t attr; /**< `OS_MEM_FAST`, `OS_MEM_DMA_CAPABLE`, `OS_MEM_BULK` the region provides*/
+} os_mem_pool_dsc_t;
+
+/**
+ * A free block of an ISR cache. While a block is free its payload area
+ * holds the `next` pointer; a pointer to the owning cache sits in front
+ * of the payload for the whole life of the block.
+ */
+typedef struct _os_mem_isr_node_t {
+    struct _os_mem_isr_node_t * next;
+} os_mem_isr_node_t;
+
+/**
+ * One fixed-size ISR block cache with a lock-free LIFO freelist.
+ */
+typedef struct _os_mem_isr_cache_t {
+    os_mem_isr_node_t * head;
+    uint16_t block_size;
+    uint16_t target_cnt;
+    volatile uint16_t avail;
+} os_mem_isr_cache_t;
+
+#if OS_MEM_USE_TAGS
+/*Hidden header in front of every allocation: the tag in the low byte.
+ *A pointer wide word keeps the payload pointer aligned.*/
+typedef os_uintptr_t os_mem_tag_hdr_t;
+#endif
+
+/*Hidden header in front of every `os_mem_buf_get` buffer*/
+typedef struct _os_mem_buf_node_t {
+    struct _os_mem_buf_node_t * next; /*Next free buffer of the same bin*/
+    uint32_t release_tick;            /*When the buffer was released the last time*/
+    uint8_t bin;                      /*Bin index or BUF_BIN_NONE*/
+} os_mem_buf_node_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+  static void pool_add(void * base, size_t size, uint8_t attr);
+#if OS_MEM_SDRAM_SIZE > 0
+  static void pool_add_ctrl(void * ctrl_mem, void * base, size_t size, uint8_t attr);
+#endif
+  static void pool_order_update(void);
+  static void * mem_alloc_core(size_t size, uint8_t attr, uint8_t tag);
+  static uint8_t buf_bin_index(uint32_t size);
+  static os_mem_pool_dsc_t * pool_find(const void * ptr);
+  static size_t mem_dma_payload_size(const void * ptr);
   static void os_mem_walker(void * ptr, size_t size, int used, void * user);
+  static void os_mem_monitor_pct(os_mem_monitor_t * mon_p);
 
 
 /**********************
  *  STATIC VARIABLES
  **********************/
-  static os_tlsf_t tlsf;
+  static os_mem_pool_dsc_t pool_tbl[OS_MEM_POOL_CNT];
+  static uint8_t pool_cnt;
+  /*`pool_tbl` indices sorted by ascending base address: allocations are
+   *placed low-address first so the overflow pools drain over time and
+   *`os_mem_shrink` can give them back*/
+  static uint8_t pool_order[OS_MEM_POOL_CNT];
+  static void * internal_pool_base; /*The fallback pool `os_mem_shrink` never removes*/
   static uint32_t cur_used;
   static uint32_t max_used;
 
+#if OS_MEM_USE_TAGS
+  static os_mem_tag_stats_t tag_stats_tbl[OS_MEM_TAG_CNT];
+  static uint8_t default_tag = OS_MEM_TAG_DEFAULT;
+#endif
+
+  static os_mem_isr_cache_t isr_cache_tbl[] = {
+      {NULL, OS_MEM_ISR_SMALL_SIZE, OS_MEM_ISR_SMALL_CNT, 0},
+      {NULL, OS_MEM_ISR_LARGE_SIZE, OS_MEM_ISR_LARGE_CNT, 0},
+  };
+#define ISR_CACHE_CNT (sizeof(isr_cache_tbl) / sizeof(isr_cache_tbl[0]))
+
 
 static uint32_t zero_mem = ZERO_MEM_SENTINEL; /*Give the address of this variable if 0 byte should be allocated*/
 
+/*Freelists of the temporal buffer cache, one per power of two size bin.
+ *Pushed/popped at the head, so a list is ordered by release time and the
+ *stale buffers cluster at its tail.*/
+#define BUF_BIN_CNT (OS_MEM_BUF_MAX_SHIFT - OS_MEM_BUF_MIN_SHIFT + 1)
+#define BUF_BIN_NONE 0xFF /*The buffer is larger than the largest bin*/
+static os_mem_buf_node_t * buf_bins[BUF_BIN_CNT];
+static uint8_t buf_bin_lens[BUF_BIN_CNT];
+
 /**********************
  *      MACROS
  **********************/
@@ -45,8 +149,6 @@ static uint32_t zero_mem = ZERO_MEM_SENTINEL; /*Give the address of this variabl
 #define SET32(x) *d32 = x; d32++;
 #define SET8(x) *d8 = x; d8++;
 #define REPEAT8(expr) expr expr expr expr expr expr expr expr
-
-os_mem_buf_t os_mem_buf[OS_MEM_BUF_MAX_NUM];
 /**********************
  *   GLOBAL FUNCTIONS
  **********************/
@@ -58,17 +160,65 @@ void os_mem_init(void)
 {
   /*Allocate a large array to store the dynamically allocated data*/
   static uint32_t work_mem_int[OS_MEM_SIZE / sizeof(uint32_t)];
-  tlsf = os_tlsf_create_with_pool((void *)work_mem_int, OS_MEM_SIZE);
+  uint8_t * work_mem = (uint8_t *)work_mem_int;
+  size_t work_size = OS_MEM_SIZE;
+
+  pool_cnt = 0;
+
+  /*The optional placement regions come first so `os_mem_alloc_attr`
+   *prefers them over the internal fallback pool*/
+#if OS_MEM_DTCM_SIZE > 0
+  pool_add((void *)OS_MEM_DTCM_BASE, OS_MEM_DTCM_SIZE, OS_MEM_FAST);
+#endif
+#if OS_MEM_AXI_SIZE > 0
+  pool_add((void *)OS_MEM_AXI_BASE, OS_MEM_AXI_SIZE, OS_MEM_DMA_CAPABLE);
+#endif
+#if OS_MEM_SDRAM_SIZE > 0
+  /*Out-of-band control: the TLSF index of the SDRAM tier is carved from
+   *the internal work memory, so the bucket metadata consulted on every
+   *alloc/free never touches the slow external bus*/
+  size_t sdram_ctrl_size = (os_tlsf_size() + 7U) & ~(size_t)7U;
+  pool_add_ctrl(work_mem, (void *)OS_MEM_SDRAM_BASE, OS_MEM_SDRAM_SIZE,
+                OS_MEM_BULK | OS_MEM_DMA_CAPABLE);
+  work_mem += sdram_ctrl_size;
+  work_size -= sdram_ctrl_size;
+#endif
 
+  /*The internal pool serves plain `os_mem_alloc` and acts as fallback.
+   *The static array ends up in the normal data RAM (AXI SRAM on the
+   *STM32H7) which every DMA master can reach.*/
+  pool_add(work_mem, work_size, OS_MEM_DMA_CAPABLE);
+  internal_pool_base = work_mem; /*Never given back by `os_mem_shrink`*/
+
+#if OS_MEM_USE_TAGS
+  os_memset_00(tag_stats_tbl, sizeof(tag_stats_tbl));
+  default_tag = OS_MEM_TAG_DEFAULT;
+#endif
+
+  /*Reset the caches (the pools above were re-created so any old cached
+   *blocks are gone with them), then pre-fill the ISR caches*/
+  uint8_t i;
+  for(i = 0; i < BUF_BIN_CNT; i++) {
+      buf_bins[i] = NULL;
+      buf_bin_lens[i] = 0;
+  }
+  for(i = 0; i < ISR_CACHE_CNT; i++) {
+      isr_cache_tbl[i].head  = NULL;
+      isr_cache_tbl[i].avail = 0;
+  }
+  os_mem_isr_refill();
 }
 
 /**
  * Clean up the memory buffer which frees all the allocated memories.
  * @note It work only if `LV_MEM_CUSTOM == 0`
  */
-void lv_mem_deinit(void)
+void os_mem_deinit(void)
 {
-  os_tlsf_destroy(tlsf);
+  uint8_t i;
+  for(i = 0; i < pool_cnt; i++) {
+      os_tlsf_destroy(pool_tbl[i].tlsf);
+  }
   os_mem_init();
 }
 
@@ -78,25 +228,218 @@ void lv_mem_deinit(void)
  * @return pointer to the allocated memory
  */
 void * os_mem_alloc(size_t size)
+{
+#if OS_MEM_USE_TAGS
+    return mem_alloc_core(size, 0, default_tag);
+#else
+    return mem_alloc_core(size, 0, OS_MEM_TAG_DEFAULT);
+#endif
+}
+
+/**
+ * Allocate a memory dynamically from the region matching the attributes
+ * @param size size of the memory to allocate in bytes
+ * @param attr `OS_MEM_FAST`, `OS_MEM_DMA_CAPABLE` and/or `OS_MEM_BULK`.
+ *             `OS_MEM_DMA_CAPABLE` is a hard constraint, the others are
+ *             placement preferences with fallback to any suitable pool.
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_attr(size_t size, uint8_t attr)
+{
+#if OS_MEM_USE_TAGS
+    return mem_alloc_core(size, attr, default_tag);
+#else
+    return mem_alloc_core(size, attr, OS_MEM_TAG_DEFAULT);
+#endif
+}
+
+/**
+ * Allocate a memory dynamically, attributed to a tag
+ * @param size size of the memory to allocate in bytes
+ * @param tag the tag to account the allocation to [0..OS_MEM_TAG_CNT-1]
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_tagged(size_t size, uint8_t tag)
+{
+    return mem_alloc_core(size, 0, tag);
+}
+
+/**
+ * Allocate a cache line aligned, line padded buffer from a DMA capable
+ * region. See the header for the guarantees.
+ * @param size size of the memory to allocate in bytes
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_dma(size_t size)
 {
     if(size == 0) {
         return &zero_mem;
     }
-    void * alloc = os_tlsf_malloc(tlsf, size);
-    if(alloc == NULL) {
 
-#if LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
-        os_mem_monitor_t mon;
-        os_mem_monitor(&mon);
+    /*Pad to whole lines so invalidating the tail cannot hit a neighbor*/
+    size = (size + OS_MEM_CACHE_LINE - 1) & ~((size_t)OS_MEM_CACHE_LINE - 1);
+
+#if OS_MEM_USE_TAGS
+    /*The hidden header would shift the payload off the line boundary, so
+     *reserve a whole line for it in front*/
+    size_t raw_size = size + OS_MEM_CACHE_LINE;
+#else
+    size_t raw_size = size;
 #endif
+
+    void * alloc = NULL;
+    uint8_t i;
+    for(i = 0; i < pool_cnt && alloc == NULL; i++) {
+        os_mem_pool_dsc_t * pool = &pool_tbl[pool_order[i]];
+        if((pool->attr & OS_MEM_DMA_CAPABLE) == 0) continue;
+        alloc = os_tlsf_memalign(pool->tlsf, OS_MEM_CACHE_LINE, raw_size);
     }
-    if(alloc) {
-        cur_used += size;
-        max_used = OS_MAX(cur_used, max_used);
-    }
+    if(alloc == NULL) return NULL;
+
+    cur_used += raw_size;
+    max_used = OS_MAX(cur_used, max_used);
+
+#if OS_MEM_USE_TAGS
+    uint8_t tag = default_tag;
+    os_mem_tag_stats_t * stats = &tag_stats_tbl[tag];
+    stats->cur_size += os_tlsf_block_size(alloc);
+    stats->peak_size = OS_MAX(stats->cur_size, stats->peak_size);
+    stats->alloc_cnt++;
+
+    alloc = (uint8_t *)alloc + OS_MEM_CACHE_LINE;
+    *((os_mem_tag_hdr_t *)alloc - 1) = (os_mem_tag_hdr_t)tag | MEM_HDR_DMA;
+#endif
+
     return alloc;
 }
 
+/**
+ * Clean the D-cache over a whole `os_mem_alloc_dma` buffer
+ * @param ptr the buffer
+ */
+void os_mem_dma_clean(const void * ptr)
+{
+    size_t size = mem_dma_payload_size(ptr);
+    uint32_t addr = (uint32_t)(os_uintptr_t)ptr;
+    uint32_t end = addr + (uint32_t)size;
+    OS_DSB();
+    for(; addr < end; addr += OS_MEM_CACHE_LINE) SCB_DCCMVAC = addr;
+    OS_DSB();
+}
+
+/**
+ * Invalidate the D-cache over a whole `os_mem_alloc_dma` buffer
+ * @param ptr the buffer
+ */
+void os_mem_dma_invalidate(const void * ptr)
+{
+    size_t size = mem_dma_payload_size(ptr);
+    uint32_t addr = (uint32_t)(os_uintptr_t)ptr;
+    uint32_t end = addr + (uint32_t)size;
+    OS_DSB();
+    for(; addr < end; addr += OS_MEM_CACHE_LINE) SCB_DCIMVAC = addr;
+    OS_DSB();
+}
+
+/**
+ * Set the tag `os_mem_alloc` attributes its allocations to
+ * @param tag the new default tag [0..OS_MEM_TAG_CNT-1]
+ */
+void os_mem_set_default_tag(uint8_t tag)
+{
+#if OS_MEM_USE_TAGS
+    default_tag = tag < OS_MEM_TAG_CNT ? tag : OS_MEM_TAG_DEFAULT;
+#else
+    OS_UNUSED(tag);
+#endif
+}
+
+/**
+ * Get the allocation statistics of a tag
+ * @param tag the tag to query [0..OS_MEM_TAG_CNT-1]
+ * @param stats_p pointer to an `os_mem_tag_stats_t` variable,
+ *                the statistics will be copied here
+ */
+void os_mem_tag_stats(uint8_t tag, os_mem_tag_stats_t * stats_p)
+{
+#if OS_MEM_USE_TAGS
+    if(tag >= OS_MEM_TAG_CNT) tag = OS_MEM_TAG_DEFAULT;
+    *stats_p = tag_stats_tbl[tag];
+#else
+    OS_UNUSED(tag);
+    os_memset_00(stats_p, sizeof(os_mem_tag_stats_t));
+#endif
+}
+
+/**
+ * Allocate a memory block from the pre-filled ISR caches.
+ * Safe to call from interrupt handlers at any priority: the pop runs with
+ * interrupts masked for a few cycles (a CAS pop is ABA-unsafe when a
+ * higher priority ISR pops and pushes the same head in between), the TLSF
+ * heap is never touched.
+ * @param size size of the memory to allocate in bytes
+ * @return pointer to the allocated memory or NULL if `size` exceeds the
+ *         largest cache block or the caches are exhausted
+ */
+void * os_mem_alloc_isr(size_t size)
+{
+    uint8_t i;
+    for(i = 0; i < ISR_CACHE_CNT; i++) {
+        os_mem_isr_cache_t * cache = &isr_cache_tbl[i];
+        if(size > cache->block_size) continue;
+
+        OS_MEM_ENTER_CRITICAL();
+        os_mem_isr_node_t * node = cache->head;
+        if(node) {
+            cache->head = node->next;
+            cache->avail--;
+        }
+        OS_MEM_EXIT_CRITICAL();
+        if(node) return node;
+        /*This cache is empty: a larger one might still have blocks*/
+    }
+    return NULL;
+}
+
+/**
+ * Give back a block allocated with `os_mem_alloc_isr`.
+ * Safe to call from interrupt handlers (lock-free push) and from thread
+ * context as well.
+ * @param data pointer to an allocated memory
+ */
+void os_mem_free_isr(void * data)
+{
+    if(data == NULL) return;
+
+    os_mem_isr_cache_t * cache = *((os_mem_isr_cache_t **)data - 1);
+    os_mem_isr_node_t * node = data;
+
+    node->next = __atomic_load_n(&cache->head, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&cache->head, &node->next, node,
+                                       false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) ;
+    __atomic_fetch_add(&cache->avail, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Fill the ISR caches up to their configured block counts from the TLSF
+ * heap. Call it from thread context only (e.g. the main loop or a timer);
+ * `os_mem_init` performs the initial fill.
+ */
+void os_mem_isr_refill(void)
+{
+    uint8_t i;
+    for(i = 0; i < ISR_CACHE_CNT; i++) {
+        os_mem_isr_cache_t * cache = &isr_cache_tbl[i];
+        while(cache->avail < cache->target_cnt) {
+            /*One pointer in front of the payload remembers the owner cache*/
+            os_mem_isr_cache_t ** block = os_mem_alloc(sizeof(os_mem_isr_cache_t *) + cache->block_size);
+            if(block == NULL) return;
+            *block = cache;
+            os_mem_free_isr(block + 1); /*Push the fresh block to the freelist*/
+        }
+    }
+}
+
 /**
  * Free an allocated data
  * @param data pointer to an allocated memory
@@ -105,9 +448,30 @@ void os_mem_free(void * data)
 {
     if(data == &zero_mem) return;
     if(data == NULL) return;
-    size_t size = os_tlsf_free(tlsf, data);
+
+#if OS_MEM_USE_TAGS
+    os_mem_tag_hdr_t hdr = *((os_mem_tag_hdr_t *)data - 1);
+    uint8_t tag = (uint8_t)hdr;
+    if(tag >= OS_MEM_TAG_CNT) tag = OS_MEM_TAG_DEFAULT;
+
+    /*DMA buffers sit a whole cache line after their raw block*/
+    if(hdr & MEM_HDR_DMA) data = (uint8_t *)data - OS_MEM_CACHE_LINE;
+    else data = (os_mem_tag_hdr_t *)data - 1;
+
+    os_mem_tag_stats_t * stats = &tag_stats_tbl[tag];
+    size_t block = os_tlsf_block_size(data);
+    stats->cur_size = stats->cur_size > block ? stats->cur_size - block : 0;
+    if(stats->alloc_cnt) stats->alloc_cnt--;
+#endif
+
+    os_mem_pool_dsc_t * pool = pool_find(data);
+    if(pool == NULL) return;
+
+    size_t size = os_tlsf_free(pool->tlsf, data);
     if(cur_used > size) cur_used -= size;
     else cur_used = 0;
+
+    OS_TRACE_ADD(OS_TRACE_EVT_MEM_FREE, size);
 }
 
 /**
@@ -126,112 +490,269 @@ void * os_mem_realloc(void * data_p, size_t new_size)
 
     if(data_p == &zero_mem) return os_mem_alloc(new_size);
 
-    void * new_p = os_tlsf_realloc(tlsf, data_p, new_size);
+#if OS_MEM_USE_TAGS
+    void * raw_p = (os_mem_tag_hdr_t *)data_p - 1;
+    uint8_t tag = (uint8_t)*(os_mem_tag_hdr_t *)raw_p;
+    if(tag >= OS_MEM_TAG_CNT) tag = OS_MEM_TAG_DEFAULT;
+
+    /*A DMA buffer must keep its alignment and padding: always move*/
+    if(*(os_mem_tag_hdr_t *)raw_p & MEM_HDR_DMA) {
+        size_t old_size = mem_dma_payload_size(data_p);
+        void * new_dma = os_mem_alloc_dma(new_size);
+        if(new_dma == NULL) return NULL;
+        os_memcpy(new_dma, data_p, old_size < new_size ? old_size : new_size);
+        os_mem_free(data_p);
+        return new_dma;
+    }
+
+    size_t old_block = os_tlsf_block_size(raw_p);
+    size_t raw_size = new_size + sizeof(os_mem_tag_hdr_t);
+#else
+    void * raw_p = data_p;
+    size_t raw_size = new_size;
+#endif
+
+    os_mem_pool_dsc_t * pool = pool_find(raw_p);
+    if(pool == NULL) return NULL;
+
+    void * new_p = os_tlsf_realloc(pool->tlsf, raw_p, raw_size);
 
     if(new_p == NULL) {
-        return NULL;
+        /*The pool of the data is full: move the data to an other pool*/
+        size_t old_size = os_tlsf_block_size(raw_p);
+#if OS_MEM_USE_TAGS
+        old_size -= sizeof(os_mem_tag_hdr_t);
+        new_p = os_mem_alloc_tagged(new_size, tag);
+#else
+        new_p = os_mem_alloc(new_size);
+#endif
+        if(new_p == NULL) return NULL;
+        os_memcpy(new_p, data_p, old_size < new_size ? old_size : new_size);
+        os_mem_free(data_p);
+        return new_p;
     }
 
+#if OS_MEM_USE_TAGS
+    /*The header (and the tag in it) moved with the data; only the block
+     *size changed*/
+    os_mem_tag_stats_t * stats = &tag_stats_tbl[tag];
+    size_t new_block = os_tlsf_block_size(new_p);
+    stats->cur_size = stats->cur_size > old_block ? stats->cur_size - old_block : 0;
+    stats->cur_size += new_block;
+    stats->peak_size = OS_MAX(stats->cur_size, stats->peak_size);
+    new_p = (os_mem_tag_hdr_t *)new_p + 1;
+#endif
+
     return new_p;
 }
 
+/**
+ * Give back every registered pool that has become entirely free.
+ * The internal fallback pool is never removed. Call `os_mem_buf_free_all`
+ * (or wait for `os_mem_buf_trim`) first: cached buffers count as live
+ * allocations and pin their pool.
+ * @return the number of bytes detached from the allocator
+ */
+size_t os_mem_shrink(void)
+{
+    size_t reclaimed = 0;
+    uint8_t i = 0;
+
+    while(i < pool_cnt) {
+        os_mem_pool_dsc_t * pool = &pool_tbl[i];
+        if(pool->base == internal_pool_base ||
+           os_tlsf_remove_pool(pool->tlsf, pool->tlsf_pool) != 0) {
+            i++; /*Still holds allocations (or is the fallback): keep it*/
+            continue;
+        }
+
+        reclaimed += pool->size;
+
+        /*Close the gap in the table*/
+        pool_cnt--;
+        uint8_t j;
+        for(j = i; j < pool_cnt; j++) pool_tbl[j] = pool_tbl[j + 1];
+    }
+
+    pool_order_update();
+    return reclaimed;
+}
+
 os_res_t os_mem_test(void)
 {
     if(zero_mem != ZERO_MEM_SENTINEL) {
         return OS_RES_INV;
     }
-    if(os_tlsf_check(tlsf)) {
-        return OS_RES_INV;
-    }
 
-    if(os_tlsf_check_pool(os_tlsf_get_pool(tlsf))) {
-        return OS_RES_INV;
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) {
+        if(os_tlsf_check(pool_tbl[i].tlsf)) {
+            return OS_RES_INV;
+        }
+        if(os_tlsf_check_pool(pool_tbl[i].tlsf_pool)) {
+            return OS_RES_INV;
+        }
     }
     return OS_RES_OK;
 }
 
 /**
- * Give information about the work memory of dynamic allocation
+ * Give information about the work memory of dynamic allocation.
+ * Reads the statistics the allocator maintains incrementally: a handful
+ * of loads, safe to call from a fast telemetry timer.
  * @param mon_p pointer to a lv_mem_monitor_t variable,
  *              the result of the analysis will be stored here
  */
 void os_mem_monitor(os_mem_monitor_t * mon_p)
+{
+    os_mem_monitor_attr(0, mon_p);
+}
+
+/**
+ * Like `os_mem_monitor` but restricted to the pools providing all the
+ * given placement attributes, so the tiers can be watched separately.
+ * @param attr `OS_MEM_FAST`, `OS_MEM_DMA_CAPABLE` and/or `OS_MEM_BULK`;
+ *             0: every pool
+ * @param mon_p pointer to a lv_mem_monitor_t variable,
+ *              the result of the analysis will be stored here
+ */
+void os_mem_monitor_attr(uint8_t attr, os_mem_monitor_t * mon_p)
 {
     /*Init the data*/
     os_memset(mon_p, 0, sizeof(os_mem_monitor_t));
-    os_tlsf_walk_pool(os_tlsf_get_pool(tlsf), os_mem_walker, mon_p);
-    mon_p->total_size = OS_MEM_SIZE;
-    mon_p->used_pct = 100 - (100U * mon_p->free_size) / mon_p->total_size;
-    if(mon_p->free_size > 0) {
-        mon_p->frag_pct = mon_p->free_biggest_size * 100U / mon_p->free_size;
-        mon_p->frag_pct = 100 - mon_p->frag_pct;
+
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) {
+        if((pool_tbl[i].attr & attr) != attr) continue;
+
+        os_tlsf_stats_t stats;
+        os_tlsf_get_stats(pool_tbl[i].tlsf, &stats);
+        mon_p->free_cnt  += stats.free_cnt;
+        mon_p->free_size += stats.free_size;
+        mon_p->used_cnt  += stats.used_cnt;
+        if(stats.free_biggest_size > mon_p->free_biggest_size) {
+            mon_p->free_biggest_size = stats.free_biggest_size;
+        }
+        mon_p->total_size += pool_tbl[i].size;
     }
-    else {
-        mon_p->frag_pct = 0; /*no fragmentation if all the RAM is used*/
+
+    os_mem_monitor_pct(mon_p);
+}
+
+/**
+ * Like `os_mem_monitor` but walks every block header of every pool.
+ * Exact (`free_biggest_size` is the real block size, not a size class
+ * bound) but slow on a fragmented heap: meant for debugging.
+ * @param mon_p pointer to a lv_mem_monitor_t variable,
+ *              the result of the analysis will be stored here
+ */
+void os_mem_monitor_deep(os_mem_monitor_t * mon_p)
+{
+    /*Init the data*/
+    os_memset(mon_p, 0, sizeof(os_mem_monitor_t));
+
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) {
+        os_tlsf_walk_pool(pool_tbl[i].tlsf_pool, os_mem_walker, mon_p);
+        mon_p->total_size += pool_tbl[i].size;
     }
-    mon_p->max_used = max_used;
+
+    os_mem_monitor_pct(mon_p);
 }
 
 
 /**
  * Get a temporal buffer with the given size.
+ * O(1): pop from the size bin of `size` or allocate if the bin is empty.
  * @param size the required size
  */
 void * os_mem_buf_get(uint32_t size)
 {
     if(size == 0) return NULL;
 
-    /*Try to find a free buffer with suitable size*/
-    int8_t i_guess = -1;
-    for(uint8_t i = 0; i < OS_MEM_BUF_MAX_NUM; i++) {
-        if(os_mem_buf[i].used == 0 && os_mem_buf[i].size >= size) {
-            if(os_mem_buf[i].size == size) {
-            	os_mem_buf[i].used = 1;
-                return os_mem_buf[i].p;
-            }
-            else if(i_guess < 0) {
-                i_guess = i;
-            }
-            /*If size of `i` is closer to `size` prefer it*/
-            else if(os_mem_buf[i].size < os_mem_buf[i_guess].size) {
-                i_guess = i;
-            }
-        }
-    }
+    uint8_t bin = buf_bin_index(size);
+    size_t payload_size;
 
-    if(i_guess >= 0) {
-    	os_mem_buf[i_guess].used = 1;
-        return os_mem_buf[i_guess].p;
+    if(bin == BUF_BIN_NONE) {
+        payload_size = size; /*Too large to cache: one shot allocation*/
     }
-
-    /*Reallocate a free buffer*/
-    for(uint8_t i = 0; i < OS_MEM_BUF_MAX_NUM; i++) {
-        if(os_mem_buf[i].used == 0) {
-            /*if this fails you probably need to increase your LV_MEM_SIZE/heap size*/
-            void * buf = os_mem_realloc(os_mem_buf[i].p, size);
-            if(buf == NULL) return NULL;
-
-            os_mem_buf[i].used = 1;
-            os_mem_buf[i].size = size;
-            os_mem_buf[i].p    = buf;
-            return os_mem_buf[i].p;
+    else {
+        /*Reuse the most recently released buffer of the bin, it is the
+         *most likely to still be in the cache*/
+        os_mem_buf_node_t * node = buf_bins[bin];
+        if(node) {
+            buf_bins[bin] = node->next;
+            buf_bin_lens[bin]--;
+            return node + 1;
         }
+        payload_size = 1UL << (bin + OS_MEM_BUF_MIN_SHIFT);
     }
-    return NULL;
+
+    /*if this fails you probably need to increase your OS_MEM_SIZE/heap size*/
+    os_mem_buf_node_t * node = os_mem_alloc(sizeof(os_mem_buf_node_t) + payload_size);
+    if(node == NULL) return NULL;
+
+    node->bin = bin;
+    return node + 1;
 }
 
 /**
- * Release a memory buffer
+ * Release a memory buffer.
+ * O(1): push back to the size bin, or free the buffer if the bin is full
+ * or the buffer is unbinned.
  * @param p buffer to release
  */
 void os_mem_buf_release(void * p)
 {
-  for(uint8_t i = 0; i < OS_MEM_BUF_MAX_NUM; i++) {
-      if(os_mem_buf[i].p == p) {
-    	  os_mem_buf[i].used = 0;
-          return;
-      }
-  }
+    if(p == NULL) return;
+
+    os_mem_buf_node_t * node = (os_mem_buf_node_t *)p - 1;
+    uint8_t bin = node->bin;
+
+    if(bin == BUF_BIN_NONE || buf_bin_lens[bin] >= OS_MEM_BUF_BIN_DEPTH) {
+        os_mem_free(node);
+        return;
+    }
+
+    /*Lazy aging: a head not reused since the age limit means the whole
+     *bin is idle, shrink it by one*/
+    os_mem_buf_node_t * head = buf_bins[bin];
+    if(head && os_tick_elaps(head->release_tick) > OS_MEM_BUF_MAX_AGE_MS) {
+        buf_bins[bin] = head->next;
+        buf_bin_lens[bin]--;
+        os_mem_free(head);
+    }
+
+    node->release_tick = os_tick_get();
+    node->next = buf_bins[bin];
+    buf_bins[bin] = node;
+    buf_bin_lens[bin]++;
+}
+
+/**
+ * Return the cached buffers not reused for `OS_MEM_BUF_MAX_AGE_MS` to the
+ * heap. Call it periodically from a housekeeping timer.
+ */
+void os_mem_buf_trim(void)
+{
+    uint8_t bin;
+    for(bin = 0; bin < BUF_BIN_CNT; bin++) {
+        /*The lists are ordered by release time: everything behind the
+         *first stale buffer is stale too*/
+        os_mem_buf_node_t ** node_p = &buf_bins[bin];
+        while(*node_p && os_tick_elaps((*node_p)->release_tick) <= OS_MEM_BUF_MAX_AGE_MS) {
+            node_p = &(*node_p)->next;
+        }
+
+        os_mem_buf_node_t * stale = *node_p;
+        *node_p = NULL;
+        while(stale) {
+            os_mem_buf_node_t * next = stale->next;
+            os_mem_free(stale);
+            buf_bin_lens[bin]--;
+            stale = next;
+        }
+    }
 }
 
 /**
@@ -239,14 +760,17 @@ void os_mem_buf_release(void * p)
  */
 void os_mem_buf_free_all(void)
 {
-  for(uint8_t i = 0; i < OS_MEM_BUF_MAX_NUM; i++) {
-      if(os_mem_buf[i].p) {
-    	  os_mem_free(os_mem_buf[i].p);
-    	  os_mem_buf[i].p = NULL;
-    	  os_mem_buf[i].used = 0;
-    	  os_mem_buf[i].size = 0;
-      }
-  }
+    uint8_t bin;
+    for(bin = 0; bin < BUF_BIN_CNT; bin++) {
+        os_mem_buf_node_t * node = buf_bins[bin];
+        while(node) {
+            os_mem_buf_node_t * next = node->next;
+            os_mem_free(node);
+            node = next;
+        }
+        buf_bins[bin] = NULL;
+        buf_bin_lens[bin] = 0;
+    }
 }
 
 /**
@@ -257,6 +781,16 @@ void os_mem_buf_free_all(void)
  */
 void* os_memcpy(void * dst, const void * src, size_t len)
 {
+#if OS_HAL_DMA_USE_MDMA
+    if(len >= OS_MEM_DMA_COPY_LIMIT) {
+        if(os_hal_dma_copy(dst, src, len, NULL, NULL) == OS_RES_OK) {
+            /*Overlap the transfer with timer work instead of stalling*/
+            while(os_hal_dma_busy()) os_timer_handler();
+            return dst;
+        }
+    }
+#endif
+
     uint8_t * d8 = dst;
     const uint8_t * s8 = src;
 
@@ -311,6 +845,44 @@ void* os_memcpy(void * dst, const void * src, size_t len)
     return dst;
 }
 
+/**
+ * Copy a memory block on the MDMA without blocking the caller.
+ * Falls back to a CPU copy (with the callback fired before returning)
+ * when the MDMA is disabled or busy.
+ * @param dst pointer to the destination buffer
+ * @param src pointer to the source buffer
+ * @param len number of byte to copy
+ * @param done_cb called when the copy finished
+ * @param user_data passed to `done_cb`
+ */
+void os_memcpy_async(void * dst, const void * src, size_t len,
+                     os_hal_dma_done_cb_t done_cb, void * user_data)
+{
+    if(os_hal_dma_copy(dst, src, len, done_cb, user_data) == OS_RES_OK) return;
+
+    os_memcpy(dst, src, len);
+    if(done_cb) done_cb(user_data);
+}
+
+/**
+ * Fill a memory block on the MDMA without blocking the caller.
+ * Falls back to the CPU (with the callback fired before returning)
+ * when the MDMA is disabled or busy.
+ * @param dst pointer to the destination buffer
+ * @param v value to set [0..255]
+ * @param len number of byte to set
+ * @param done_cb called when the fill finished
+ * @param user_data passed to `done_cb`
+ */
+void os_memset_async(void * dst, uint8_t v, size_t len,
+                     os_hal_dma_done_cb_t done_cb, void * user_data)
+{
+    if(os_hal_dma_set(dst, v, len, done_cb, user_data) == OS_RES_OK) return;
+
+    os_memset(dst, v, len);
+    if(done_cb) done_cb(user_data);
+}
+
 /**
  * Same as `memset` but optimized for 4 byte operation.
  * @param dst pointer to the destination buffer
@@ -319,6 +891,16 @@ void* os_memcpy(void * dst, const void * src, size_t len)
  */
 void os_memset(void * dst, uint8_t v, size_t len)
 {
+#if OS_HAL_DMA_USE_MDMA
+    if(len >= OS_MEM_DMA_COPY_LIMIT) {
+        if(os_hal_dma_set(dst, v, len, NULL, NULL) == OS_RES_OK) {
+            /*Overlap the transfer with timer work instead of stalling*/
+            while(os_hal_dma_busy()) os_timer_handler();
+            return;
+        }
+    }
+#endif
+
   uint8_t * d8 = (uint8_t *)dst;
   uintptr_t d_align = (os_uintptr_t) d8 & ALIGN_MASK;
 
@@ -434,6 +1016,196 @@ void os_memset_ff(void * dst, size_t len)
  *   STATIC FUNCTIONS
  **********************/
 
+/**
+ * Register a memory region as a TLSF managed pool
+ * @param base start address of the region (must be 4 byte aligned)
+ * @param size size of the region in bytes
+ * @param attr the placement attributes the region provides
+ */
+static void pool_add(void * base, size_t size, uint8_t attr)
+{
+    if(pool_cnt >= OS_MEM_POOL_CNT) return;
+
+    os_mem_pool_dsc_t * pool = &pool_tbl[pool_cnt];
+    pool->tlsf = os_tlsf_create_with_pool(base, size);
+    if(pool->tlsf == NULL) return;
+    pool->tlsf_pool = os_tlsf_get_pool(pool->tlsf);
+
+    pool->base = base;
+    pool->size = size;
+    pool->attr = attr;
+    pool_cnt++;
+    pool_order_update();
+}
+
+#if OS_MEM_SDRAM_SIZE > 0
+/**
+ * Like `pool_add` but with the TLSF control structure placed out-of-band
+ * (in `ctrl_mem`, `os_tlsf_size()` bytes), for regions on a slow external
+ * bus. The block boundary tags still live next to the payloads - that is
+ * inherent to TLSF - but the index walked on every alloc stays internal.
+ * @param ctrl_mem where to build the TLSF control structure
+ * @param base start address of the region (must be 4 byte aligned)
+ * @param size size of the region in bytes
+ * @param attr the placement attributes the region provides
+ */
+static void pool_add_ctrl(void * ctrl_mem, void * base, size_t size, uint8_t attr)
+{
+    if(pool_cnt >= OS_MEM_POOL_CNT) return;
+
+    os_mem_pool_dsc_t * pool = &pool_tbl[pool_cnt];
+    pool->tlsf = os_tlsf_create(ctrl_mem);
+    if(pool->tlsf == NULL) return;
+    pool->tlsf_pool = os_tlsf_add_pool(pool->tlsf, base, size);
+    if(pool->tlsf_pool == NULL) return;
+
+    pool->base = base;
+    pool->size = size;
+    pool->attr = attr;
+    pool_cnt++;
+    pool_order_update();
+}
+#endif /*OS_MEM_SDRAM_SIZE > 0*/
+
+/**
+ * Rebuild `pool_order`: the pool indices sorted by ascending base address
+ */
+static void pool_order_update(void)
+{
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) pool_order[i] = i;
+
+    /*Insertion sort: the table has at most OS_MEM_POOL_CNT entries*/
+    for(i = 1; i < pool_cnt; i++) {
+        uint8_t key = pool_order[i];
+        uint8_t j = i;
+        while(j > 0 && pool_tbl[pool_order[j - 1]].base > pool_tbl[key].base) {
+            pool_order[j] = pool_order[j - 1];
+            j--;
+        }
+        pool_order[j] = key;
+    }
+}
+
+/**
+ * Find the pool an allocation lives in
+ * @param ptr pointer returned by `os_mem_alloc`
+ * @return the pool descriptor or NULL if the pointer is in no pool
+ */
+static os_mem_pool_dsc_t * pool_find(const void * ptr)
+{
+    const uint8_t * p = ptr;
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) {
+        if(p >= pool_tbl[i].base && p < pool_tbl[i].base + pool_tbl[i].size) {
+            return &pool_tbl[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get the usable, line-rounded size of an `os_mem_alloc_dma` buffer from
+ * the real TLSF block size - never from what the caller remembers.
+ * Rounded down so maintenance cannot touch the next block's metadata in
+ * the TLSF slack.
+ * @param ptr the buffer
+ * @return its size in bytes, a multiple of OS_MEM_CACHE_LINE
+ */
+static size_t mem_dma_payload_size(const void * ptr)
+{
+#if OS_MEM_USE_TAGS
+    void * raw = (uint8_t *)(os_uintptr_t)ptr - OS_MEM_CACHE_LINE;
+    size_t size = os_tlsf_block_size(raw) - OS_MEM_CACHE_LINE;
+#else
+    size_t size = os_tlsf_block_size((void *)(os_uintptr_t)ptr);
+#endif
+    return size & ~((size_t)OS_MEM_CACHE_LINE - 1);
+}
+
+/**
+ * Allocate from the pools matching the attributes and account it to a tag
+ * @param size size of the memory to allocate in bytes
+ * @param attr placement attributes, see `os_mem_alloc_attr`
+ * @param tag the tag to account the allocation to
+ * @return pointer to the allocated memory
+ */
+static void * mem_alloc_core(size_t size, uint8_t attr, uint8_t tag)
+{
+    if(size == 0) {
+        return &zero_mem;
+    }
+
+#if OS_MEM_USE_TAGS
+    size += sizeof(os_mem_tag_hdr_t);
+#else
+    OS_UNUSED(tag);
+#endif
+
+    void * alloc = NULL;
+    uint8_t pref = attr & (OS_MEM_FAST | OS_MEM_BULK);
+    uint8_t need = attr & OS_MEM_DMA_CAPABLE;
+    uint8_t i;
+
+    /*Large requests go to the BULK tier (the external SDRAM) so their
+     *churn cannot fragment the small internal pool. A preference only:
+     *without a BULK pool the fallback loop below still serves them.*/
+    if(pref == 0 && size >= OS_MEM_LARGE_THRESHOLD) pref = OS_MEM_BULK;
+
+    /*First try the pools whose placement matches the preference, then fall
+     *back to any pool satisfying the hard DMA constraint. Both walks go in
+     *ascending base address order so the low pools fill first and the
+     *overflow ones drain empty, ready for `os_mem_shrink`.*/
+    for(i = 0; i < pool_cnt && alloc == NULL; i++) {
+        os_mem_pool_dsc_t * pool = &pool_tbl[pool_order[i]];
+        if((pool->attr & (OS_MEM_FAST | OS_MEM_BULK)) != pref) continue;
+        if((pool->attr & need) != need) continue;
+        alloc = os_tlsf_malloc(pool->tlsf, size);
+    }
+
+    for(i = 0; i < pool_cnt && alloc == NULL; i++) {
+        os_mem_pool_dsc_t * pool = &pool_tbl[pool_order[i]];
+        if((pool->attr & need) != need) continue;
+        alloc = os_tlsf_malloc(pool->tlsf, size);
+    }
+
+    if(alloc == NULL) return NULL;
+
+    cur_used += size;
+    max_used = OS_MAX(cur_used, max_used);
+
+#if OS_MEM_USE_TAGS
+    if(tag >= OS_MEM_TAG_CNT) tag = OS_MEM_TAG_DEFAULT;
+    *(os_mem_tag_hdr_t *)alloc = tag;
+
+    os_mem_tag_stats_t * stats = &tag_stats_tbl[tag];
+    stats->cur_size += os_tlsf_block_size(alloc);
+    stats->peak_size = OS_MAX(stats->cur_size, stats->peak_size);
+    stats->alloc_cnt++;
+
+    alloc = (os_mem_tag_hdr_t *)alloc + 1;
+#endif
+
+    OS_TRACE_ADD(OS_TRACE_EVT_MEM_ALLOC, size);
+
+    return alloc;
+}
+
+/**
+ * Get the buffer cache bin of a size
+ * @param size the requested buffer size
+ * @return the index of the smallest bin that fits `size`,
+ *         or BUF_BIN_NONE if it exceeds the largest bin
+ */
+static uint8_t buf_bin_index(uint32_t size)
+{
+    if(size <= (1UL << OS_MEM_BUF_MIN_SHIFT)) return 0;
+    if(size > (1UL << OS_MEM_BUF_MAX_SHIFT)) return BUF_BIN_NONE;
+
+    uint32_t shift = 32U - (uint32_t)__builtin_clz(size - 1U); /*ceil(log2(size))*/
+    return (uint8_t)(shift - OS_MEM_BUF_MIN_SHIFT);
+}
+
 static void os_mem_walker(void * ptr, size_t size, int used, void * user)
 {
     OS_UNUSED(ptr);
@@ -450,3 +1222,28 @@ static void os_mem_walker(void * ptr, size_t size, int used, void * user)
     }
 }
 
+/**
+ * Derive the percentages of a monitor result from the collected sizes
+ * @param mon_p partially filled monitor structure
+ */
+static void os_mem_monitor_pct(os_mem_monitor_t * mon_p)
+{
+    if(mon_p->total_size == 0) {
+        /*No pool matched the filter (e.g. an already shrunk tier)*/
+        mon_p->used_pct = 0;
+        mon_p->frag_pct = 0;
+        mon_p->max_used = max_used;
+        return;
+    }
+
+    mon_p->used_pct = 100 - (100U * mon_p->free_size) / mon_p->total_size;
+    if(mon_p->free_size > 0) {
+        mon_p->frag_pct = mon_p->free_biggest_size * 100U / mon_p->free_size;
+        mon_p->frag_pct = 100 - mon_p->frag_pct;
+    }
+    else {
+        mon_p->frag_pct = 0; /*no fragmentation if all the RAM is used*/
+    }
+    mon_p->max_used = max_used;
+}
+
@@ -19,17 +19,132 @@ extern "C" {
 
 #include "os_types.h"
 #include "os_ll.h"
+#include "os_hal_dma.h"
 /*********************
  *      DEFINES
  *********************/
-#define OS_MEM_BUF_MAX_NUM 16               //ToDo
-#define OS_MEM_SIZE        1024             //ToDo
-#define OS_MAX(a, b) ((a) > (b) ? (a) : (b))//ToDo
+/*Geometry of the temporal buffer cache (`os_mem_buf_get`): power of two
+ *size bins from `1 << OS_MEM_BUF_MIN_SHIFT` to `1 << OS_MEM_BUF_MAX_SHIFT`
+ *bytes, each keeping up to OS_MEM_BUF_BIN_DEPTH released buffers.
+ *Larger requests bypass the cache.*/
+#ifndef OS_MEM_BUF_MIN_SHIFT
+#define OS_MEM_BUF_MIN_SHIFT 5
+#endif
+#ifndef OS_MEM_BUF_MAX_SHIFT
+#define OS_MEM_BUF_MAX_SHIFT 16
+#endif
+#ifndef OS_MEM_BUF_BIN_DEPTH
+#define OS_MEM_BUF_BIN_DEPTH 4
+#endif
+
+/*A cached buffer not reused for this long is returned to the heap
+ *(checked lazily on release and by `os_mem_buf_trim`)*/
+#ifndef OS_MEM_BUF_MAX_AGE_MS
+#define OS_MEM_BUF_MAX_AGE_MS 5000
+#endif
+
+/*Size of the internal work memory (a static array, placed by the linker)*/
+#ifndef OS_MEM_SIZE
+#define OS_MEM_SIZE (16U * 1024U)
+#endif
+
+/*Upper bound for the size of any single pool. It sizes the index depth of
+ *the TLSF allocator, so keep it close to the largest configured region.*/
+#ifndef OS_MEM_POOL_MAX_SIZE
+#define OS_MEM_POOL_MAX_SIZE (8U * 1024U * 1024U)
+#endif
+
+/*Optional placement pools. Give a region a non zero size (and a base
+ *address reserved from the linker script) to let `os_mem_alloc_attr`
+ *route allocations there.*/
+#ifndef OS_MEM_DTCM_BASE
+#define OS_MEM_DTCM_BASE 0x20000000UL /*Zero wait state, not visible to DMA*/
+#endif
+#ifndef OS_MEM_DTCM_SIZE
+#define OS_MEM_DTCM_SIZE 0
+#endif
+#ifndef OS_MEM_AXI_BASE
+#define OS_MEM_AXI_BASE 0x24000000UL /*AXI SRAM, reachable by every DMA master*/
+#endif
+#ifndef OS_MEM_AXI_SIZE
+#define OS_MEM_AXI_SIZE 0
+#endif
+#ifndef OS_MEM_SDRAM_BASE
+#define OS_MEM_SDRAM_BASE 0xD0000000UL /*External SDRAM behind the FMC*/
+#endif
+#ifndef OS_MEM_SDRAM_SIZE
+#define OS_MEM_SDRAM_SIZE 0
+#endif
+
+/*The internal pool plus the three optional regions*/
+#define OS_MEM_POOL_CNT 4
+
+/*Plain `os_mem_alloc` requests of at least this size are routed to the
+ *`OS_MEM_BULK` tier (the external SDRAM) when one is configured, so
+ *large-object churn (image decode buffers etc.) cannot fragment the
+ *small internal pool. Explicit `os_mem_alloc_attr` placements win.*/
+#ifndef OS_MEM_LARGE_THRESHOLD
+#define OS_MEM_LARGE_THRESHOLD 4096U
+#endif
+
+#define OS_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/*Allocation placement attributes for `os_mem_alloc_attr`*/
+#define OS_MEM_FAST        0x01 /*Hot state: prefer the zero wait state DTCM*/
+#define OS_MEM_DMA_CAPABLE 0x02 /*Must be visible to DMA masters (DTCM is not)*/
+#define OS_MEM_BULK        0x04 /*Large or cold data: prefer the external SDRAM*/
+
+/*Pre-filled block caches for `os_mem_alloc_isr`. The caches are refilled
+ *from the TLSF heap only in thread context (`os_mem_isr_refill`), so
+ *interrupt time allocation is a single lock-free pop.*/
+#ifndef OS_MEM_ISR_SMALL_SIZE
+#define OS_MEM_ISR_SMALL_SIZE 32
+#endif
+#ifndef OS_MEM_ISR_SMALL_CNT
+#define OS_MEM_ISR_SMALL_CNT 8
+#endif
+#ifndef OS_MEM_ISR_LARGE_SIZE
+#define OS_MEM_ISR_LARGE_SIZE 256
+#endif
+#ifndef OS_MEM_ISR_LARGE_CNT
+#define OS_MEM_ISR_LARGE_CNT 4
+#endif
+
+/*Allocation tagging: every allocation is attributed to a tag so the
+ *per-subsystem consumption is visible in the field. The cost is one
+ *hidden header word per allocation and a few increments, cheap enough
+ *for production; set it to 0 to remove tagging entirely.*/
+#ifndef OS_MEM_USE_TAGS
+#define OS_MEM_USE_TAGS 1
+#endif
+#ifndef OS_MEM_TAG_CNT
+#define OS_MEM_TAG_CNT 8
+#endif
+#define OS_MEM_TAG_DEFAULT 0 /*Tag of untagged (legacy) allocations*/
+
+/*`os_memcpy`/`os_memset` hand transfers of at least this many bytes to
+ *the MDMA (only when OS_HAL_DMA_USE_MDMA is enabled in os_hal_dma.h)*/
+#ifndef OS_MEM_DMA_COPY_LIMIT
+#define OS_MEM_DMA_COPY_LIMIT 512
+#endif
+
+/*D-cache line size of the CM7: `os_mem_alloc_dma` buffers are aligned and
+ *padded to this, so cache maintenance never touches a neighbor's line*/
+#define OS_MEM_CACHE_LINE 32U
 
 /**********************
  *      TYPEDEFS
  **********************/
 
+/**
+ * Per-tag allocation statistics.
+ */
+typedef struct {
+    uint32_t cur_size;  /**< Currently allocated bytes of the tag (block sizes)*/
+    uint32_t peak_size; /**< Highest `cur_size` ever seen*/
+    uint32_t alloc_cnt; /**< Live allocations of the tag*/
+} os_mem_tag_stats_t;
+
 /**
  * Heap information structure.
  */
@@ -44,14 +159,6 @@ typedef struct {
     uint8_t frag_pct; /**< Amount of fragmentation*/
 } os_mem_monitor_t;
 
-typedef struct {
-    void * p;
-    uint16_t size;
-    uint8_t used : 1;
-} os_mem_buf_t;
-
-
-
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -74,6 +181,91 @@ void os_mem_deinit(void);
  */
 void * os_mem_alloc(size_t size);
 
+/**
+ * Allocate a memory dynamically from the region matching the attributes
+ * @param size size of the memory to allocate in bytes
+ * @param attr `OS_MEM_FAST`, `OS_MEM_DMA_CAPABLE` and/or `OS_MEM_BULK`.
+ *             `OS_MEM_DMA_CAPABLE` is a hard constraint, the others are
+ *             placement preferences with fallback to any suitable pool.
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_attr(size_t size, uint8_t attr);
+
+/**
+ * Allocate a memory dynamically, attributed to a tag
+ * @param size size of the memory to allocate in bytes
+ * @param tag the tag to account the allocation to [0..OS_MEM_TAG_CNT-1]
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_tagged(size_t size, uint8_t tag);
+
+/**
+ * Allocate a buffer suitable to hand to a DMA master: it comes from a
+ * DMA capable region, starts on a cache line boundary and its size is
+ * rounded up to whole lines, so `os_mem_dma_clean`/`os_mem_dma_invalidate`
+ * can never corrupt a neighboring allocation. Free with `os_mem_free`.
+ * @param size size of the memory to allocate in bytes
+ * @return pointer to the allocated memory
+ */
+void * os_mem_alloc_dma(size_t size);
+
+/**
+ * Clean (write back) the D-cache lines of a whole `os_mem_alloc_dma`
+ * buffer, before a DMA read from it. The extent comes from the real block
+ * size (`os_tlsf_block_size`), not from what the caller remembers, so
+ * under-cleaning is not possible.
+ * @param ptr a buffer from `os_mem_alloc_dma`
+ */
+void os_mem_dma_clean(const void * ptr);
+
+/**
+ * Invalidate the D-cache lines of a whole `os_mem_alloc_dma` buffer,
+ * after a DMA wrote into it.
+ * @param ptr a buffer from `os_mem_alloc_dma`
+ */
+void os_mem_dma_invalidate(const void * ptr);
+
+/**
+ * Set the tag `os_mem_alloc` attributes its allocations to, so legacy
+ * callers are tagged without changing every call site (e.g. set it around
+ * the init of a subsystem).
+ * @param tag the new default tag [0..OS_MEM_TAG_CNT-1]
+ */
+void os_mem_set_default_tag(uint8_t tag);
+
+/**
+ * Get the allocation statistics of a tag
+ * @param tag the tag to query [0..OS_MEM_TAG_CNT-1]
+ * @param stats_p pointer to an `os_mem_tag_stats_t` variable,
+ *                the statistics will be copied here
+ */
+void os_mem_tag_stats(uint8_t tag, os_mem_tag_stats_t * stats_p);
+
+/**
+ * Allocate a memory block from the pre-filled ISR caches.
+ * Safe to call from interrupt handlers: it is a lock-free pop, the TLSF
+ * heap is never touched.
+ * @param size size of the memory to allocate in bytes
+ * @return pointer to the allocated memory or NULL if `size` exceeds the
+ *         largest cache block or the caches are exhausted
+ */
+void * os_mem_alloc_isr(size_t size);
+
+/**
+ * Give back a block allocated with `os_mem_alloc_isr`.
+ * Safe to call from interrupt handlers (lock-free push) and from thread
+ * context as well.
+ * @param data pointer to an allocated memory
+ */
+void os_mem_free_isr(void * data);
+
+/**
+ * Fill the ISR caches up to their configured block counts from the TLSF
+ * heap. Call it from thread context only (e.g. the main loop or a timer);
+ * `os_mem_init` performs the initial fill.
+ */
+void os_mem_isr_refill(void);
+
 /**
  * Free an allocated data
  * @param data pointer to an allocated memory
@@ -89,6 +281,18 @@ void os_mem_free(void * data);
  */
 void * os_mem_realloc(void * data_p, size_t new_size);
 
+/**
+ * Give back every registered pool that has become entirely free, so a
+ * heap grown by a burst workload does not stay at its peak size forever.
+ * Allocations prefer the lowest-address pools, so the overflow pools
+ * naturally drain over time. A detached region is no longer touched by
+ * the allocator and can be reused or powered down; the internal fallback
+ * pool is never removed. Call `os_mem_buf_free_all` (or wait for
+ * `os_mem_buf_trim`) first: cached buffers pin their pool.
+ * @return the number of bytes detached from the allocator
+ */
+size_t os_mem_shrink(void);
+
 /**
  *
  * @return
@@ -96,25 +300,58 @@ void * os_mem_realloc(void * data_p, size_t new_size);
 os_res_t os_mem_test(void);
 
 /**
- * Give information about the work memory of dynamic allocation
+ * Give information about the work memory of dynamic allocation.
+ * Reads statistics the allocator maintains incrementally, so it is O(1)
+ * and safe to call from a fast telemetry timer. `free_biggest_size` is a
+ * size class lower bound, see `os_mem_monitor_deep` for the exact value.
  * @param mon_p pointer to a lv_mem_monitor_t variable,
  *              the result of the analysis will be stored here
  */
 void os_mem_monitor(os_mem_monitor_t * mon_p);
 
+/**
+ * Like `os_mem_monitor` but restricted to the pools providing all the
+ * given placement attributes, so the tiers can be watched separately
+ * (e.g. `OS_MEM_BULK` for the SDRAM tier, `OS_MEM_FAST` for the DTCM,
+ * 0 for everything, same as `os_mem_monitor`).
+ * @param attr `OS_MEM_FAST`, `OS_MEM_DMA_CAPABLE` and/or `OS_MEM_BULK`
+ * @param mon_p pointer to a lv_mem_monitor_t variable,
+ *              the result of the analysis will be stored here
+ */
+void os_mem_monitor_attr(uint8_t attr, os_mem_monitor_t * mon_p);
+
+/**
+ * Like `os_mem_monitor` but walks every block header of every pool.
+ * Exact but slow on a fragmented heap: meant for debugging.
+ * @param mon_p pointer to a lv_mem_monitor_t variable,
+ *              the result of the analysis will be stored here
+ */
+void os_mem_monitor_deep(os_mem_monitor_t * mon_p);
+
 
 /**
  * Get a temporal buffer with the given size.
+ * O(1): the buffer is popped from the power of two size bin of `size`,
+ * or allocated if the bin is empty.
  * @param size the required size
  */
 void * os_mem_buf_get(uint32_t size);
 
 /**
- * Release a memory buffer
+ * Release a memory buffer.
+ * O(1): the buffer is pushed back to its size bin for reuse (or freed if
+ * the bin is full or the buffer is larger than the largest bin).
  * @param p buffer to release
  */
 void os_mem_buf_release(void * p);
 
+/**
+ * Return the cached buffers not reused for `OS_MEM_BUF_MAX_AGE_MS` to the
+ * heap, so buffers grown by one burst do not pin memory forever.
+ * Call it periodically from a housekeeping timer.
+ */
+void os_mem_buf_trim(void);
+
 /**
  * Free all memory buffers
  */
@@ -129,6 +366,34 @@ void os_mem_buf_free_all(void);
  */
 void * os_memcpy(void * dst, const void * src, size_t len);
 
+/**
+ * Copy a memory block on the MDMA without blocking the caller.
+ * Falls back to a CPU copy (with the callback fired before returning)
+ * when the MDMA is disabled or busy.
+ * @param dst pointer to the destination buffer
+ * @param src pointer to the source buffer
+ * @param len number of byte to copy
+ * @param done_cb called when the copy finished (from interrupt context on
+ *                the DMA path, synchronously on the CPU fallback)
+ * @param user_data passed to `done_cb`
+ */
+void os_memcpy_async(void * dst, const void * src, size_t len,
+                     os_hal_dma_done_cb_t done_cb, void * user_data);
+
+/**
+ * Fill a memory block on the MDMA without blocking the caller.
+ * Falls back to the CPU (with the callback fired before returning)
+ * when the MDMA is disabled or busy.
+ * @param dst pointer to the destination buffer
+ * @param v value to set [0..255]
+ * @param len number of byte to set
+ * @param done_cb called when the fill finished (from interrupt context on
+ *                the DMA path, synchronously on the CPU fallback)
+ * @param user_data passed to `done_cb`
+ */
+void os_memset_async(void * dst, uint8_t v, size_t len,
+                     os_hal_dma_done_cb_t done_cb, void * user_data);
+
 /**
  * Same as `memcpy` but optimized to copy only a few bytes.
  * @param dst pointer to the destination buffer
@@ -0,0 +1,110 @@
+/**
+ * @file os_pool.c
+ * See os_pool.h. A free block stores the next-pointer in its own first
+ * bytes, so the pool needs no bookkeeping besides the freelist head and
+ * membership of a pointer is a two-compare range check.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_pool.h"
+#include "os_mem.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+os_res_t os_pool_init(os_blk_pool_t * pool, uint32_t block_size, uint32_t block_cnt,
+                      bool fallback)
+{
+    /*A free block holds the freelist pointer in place, so it must fit one
+     *and keep the next block pointer-aligned*/
+    if(block_size < sizeof(void *)) block_size = sizeof(void *);
+    block_size = (block_size + (uint32_t)sizeof(void *) - 1U) & ~((uint32_t)sizeof(void *) - 1U);
+
+    pool->storage = os_mem_alloc((size_t)block_size * block_cnt);
+    if(pool->storage == NULL) return OS_RES_INV;
+
+    pool->block_size = block_size;
+    pool->block_cnt = block_cnt;
+    pool->used_cnt = 0;
+    pool->used_max = 0;
+    pool->fallback_cnt = 0;
+    pool->fallback = fallback ? 1 : 0;
+
+    /*Chain the blocks in address order*/
+    pool->free_head = NULL;
+    uint32_t i;
+    for(i = block_cnt; i > 0; i--) {
+        void * block = pool->storage + (size_t)(i - 1) * block_size;
+        *(void **)block = pool->free_head;
+        pool->free_head = block;
+    }
+
+    return OS_RES_OK;
+}
+
+void os_pool_deinit(os_blk_pool_t * pool)
+{
+    os_mem_free(pool->storage);
+    pool->storage = NULL;
+    pool->free_head = NULL;
+    pool->block_cnt = 0;
+}
+
+void * os_pool_alloc(os_blk_pool_t * pool)
+{
+    void * block = pool->free_head;
+    if(block) {
+        pool->free_head = *(void **)block;
+        pool->used_cnt++;
+        if(pool->used_cnt > pool->used_max) pool->used_max = pool->used_cnt;
+        return block;
+    }
+
+    if(!pool->fallback) return NULL;
+
+    block = os_mem_alloc(pool->block_size);
+    if(block) pool->fallback_cnt++;
+    return block;
+}
+
+void os_pool_free(os_blk_pool_t * pool, void * p)
+{
+    if(p == NULL) return;
+
+    uint8_t * b = p;
+    if(b >= pool->storage && b < pool->storage + (size_t)pool->block_size * pool->block_cnt) {
+        *(void **)p = pool->free_head;
+        pool->free_head = p;
+        pool->used_cnt--;
+    }
+    else {
+        os_mem_free(p); /*Came from the exhaustion fallback*/
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
@@ -0,0 +1,96 @@
+/**
+ * @file os_pool.h
+ * Fixed-block pools for the hottest allocation sizes (timer nodes, frame
+ * descriptors, event records). Blocks are carved from one `os_mem_alloc()`
+ * slab and chained on a singly linked freelist, so alloc/free is a handful
+ * of instructions instead of the TLSF bucket search and split/merge.
+ */
+
+#ifndef OS_POOL_H
+#define OS_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/**
+ * A fixed-block pool. Create with `os_pool_init()`; the fields are public
+ * for monitoring (`used_max` is the high water mark to size the pool by),
+ * treat them as read-only.
+ * Note: this is unrelated to `os_pool_t` of os_tlsf.h, which is a raw
+ * TLSF region handle.
+ */
+typedef struct {
+    void * free_head;       /**< Head of the freelist*/
+    uint8_t * storage;      /**< The slab the blocks are carved from*/
+    uint32_t block_size;    /**< Block size, aligned up to pointer size*/
+    uint32_t block_cnt;     /**< Number of blocks in the slab*/
+    uint32_t used_cnt;      /**< Blocks currently handed out*/
+    uint32_t used_max;      /**< High water mark of `used_cnt`*/
+    uint32_t fallback_cnt;  /**< Allocations served by the general heap*/
+    uint8_t fallback;       /**< Fall back to `os_mem_alloc` when empty*/
+} os_blk_pool_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Initialize a pool: allocate the slab and build the freelist.
+ * @param pool pointer to a caller-allocated (typically static) os_blk_pool_t
+ * @param block_size size of one block in bytes
+ * @param block_cnt number of blocks to carve
+ * @param fallback true: serve allocations from the general heap when the
+ *                 pool is exhausted; false: return NULL instead
+ * @return OS_RES_OK, or OS_RES_INV if the slab allocation failed
+ */
+os_res_t os_pool_init(os_blk_pool_t * pool, uint32_t block_size, uint32_t block_cnt,
+                      bool fallback);
+
+/**
+ * Free the slab. Every block must have been returned already.
+ * @param pool pointer to an initialized os_blk_pool_t
+ */
+void os_pool_deinit(os_blk_pool_t * pool);
+
+/**
+ * Get a block: pop the freelist head.
+ * @param pool pointer to an initialized os_blk_pool_t
+ * @return a `block_size` byte block, a heap allocation if the pool ran
+ *         empty and fallback is enabled, or NULL
+ */
+void * os_pool_alloc(os_blk_pool_t * pool);
+
+/**
+ * Return a block: push it on the freelist. Fallback allocations are
+ * recognized by address and handed back to the general heap.
+ * @param pool pointer to the pool the block came from
+ * @param p the block (NULL is accepted and ignored)
+ */
+void os_pool_free(os_blk_pool_t * pool, void * p);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_POOL_H*/
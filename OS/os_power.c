@@ -0,0 +1,156 @@
+/**
+ * @file os_power.c
+ * See os_power.h. LPTIM2 sits in the SRD (D3) domain and stays
+ * functional in DStop when clocked from the LSI; its wakeup goes through
+ * EXTI line 48 and the NVIC, so a plain WFI with SLEEPDEEP set is enough
+ * to enter and leave the mode. The LPTIM runs at LSI/32 = ~1 kHz, which
+ * makes ARR/CNT read directly in milliseconds.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_power.h"
+#include "os_hal_tick.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*PWR and SCB: DStop = SLEEPDEEP with the PDDS bits of PWR_CPUCR clear*/
+#define PWR_CR1   (*(volatile uint32_t *)0x58024800UL)
+#define PWR_CPUCR (*(volatile uint32_t *)0x58024810UL)
+#define PWR_CR1_LPDS (1UL << 0)
+#define PWR_CPUCR_PDDS_ALL 0x7UL
+
+#define SCB_SCR (*(volatile uint32_t *)0xE000ED10UL)
+#define SCB_SCR_SLEEPDEEP (1UL << 2)
+
+/*RCC: LSI, the LPTIM2 bus clock and its kernel clock mux (RM0455)*/
+#define RCC_CSR      (*(volatile uint32_t *)0x58024474UL)
+#define RCC_SRDCCIPR (*(volatile uint32_t *)0x58024458UL)
+#define RCC_APB4ENR  (*(volatile uint32_t *)0x580244F4UL)
+#define RCC_CSR_LSION  (1UL << 0)
+#define RCC_CSR_LSIRDY (1UL << 1)
+#define RCC_LPTIM2SEL_MASK (0x7UL << 10)
+#define RCC_LPTIM2SEL_LSI  (0x4UL << 10)
+#define RCC_APB4ENR_LPTIM2EN (1UL << 9)
+
+/*LPTIM2 registers*/
+#define LPTIM2_BASE 0x58002400UL
+#define LPTIM2_ISR  (*(volatile uint32_t *)(LPTIM2_BASE + 0x00UL))
+#define LPTIM2_ICR  (*(volatile uint32_t *)(LPTIM2_BASE + 0x04UL))
+#define LPTIM2_IER  (*(volatile uint32_t *)(LPTIM2_BASE + 0x08UL))
+#define LPTIM2_CFGR (*(volatile uint32_t *)(LPTIM2_BASE + 0x0CUL))
+#define LPTIM2_CR   (*(volatile uint32_t *)(LPTIM2_BASE + 0x10UL))
+#define LPTIM2_ARR  (*(volatile uint32_t *)(LPTIM2_BASE + 0x18UL))
+#define LPTIM2_CNT  (*(volatile uint32_t *)(LPTIM2_BASE + 0x1CUL))
+
+#define LPTIM_CR_ENABLE  (1UL << 0)
+#define LPTIM_CR_SNGSTRT (1UL << 1)
+#define LPTIM_IER_ARRMIE (1UL << 1)
+#define LPTIM_ISR_ARRM   (1UL << 1)
+#define LPTIM_ICR_ALL    0x7FUL
+#define LPTIM_CFGR_PRESC_DIV32 (0x5UL << 9)
+
+/*EXTI: LPTIM2 wakeup is direct line 48, bit 16 of the second bank*/
+#define EXTI_C1IMR2 (*(volatile uint32_t *)0x58000090UL)
+#define EXTI_LPTIM2_LINE (1UL << 16)
+
+/*LPTIM2 interrupt: IRQ 138*/
+#define NVIC_ISER4 (*(volatile uint32_t *)0xE000E110UL)
+#define LPTIM2_IRQN_BIT (1UL << 10)
+
+#if defined(__arm__)
+#define OS_POWER_WFI() __asm volatile("dsb 0xF\n\twfi" ::: "memory")
+#else
+#define OS_POWER_WFI() do {} while(0)
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void os_power_init(void)
+{
+    /*Start the LSI but do not spin on its ~100 us settle time: the mux
+     *and LPTIM setup below need no running kernel clock, and the first
+     *STOP entry is gated on `os_power_ready` anyway (see os_boot.h)*/
+    RCC_CSR |= RCC_CSR_LSION;
+
+    RCC_SRDCCIPR = (RCC_SRDCCIPR & ~RCC_LPTIM2SEL_MASK) | RCC_LPTIM2SEL_LSI;
+    RCC_APB4ENR |= RCC_APB4ENR_LPTIM2EN;
+    (void)RCC_APB4ENR; /*Read back: let the clock settle*/
+
+    /*IER is writable only while the LPTIM is disabled*/
+    LPTIM2_CR = 0;
+    LPTIM2_CFGR = LPTIM_CFGR_PRESC_DIV32; /*LSI/32: ~1 ms per count*/
+    LPTIM2_IER = LPTIM_IER_ARRMIE;
+
+    EXTI_C1IMR2 |= EXTI_LPTIM2_LINE;
+    NVIC_ISER4 = LPTIM2_IRQN_BIT;
+}
+
+bool os_power_ready(void)
+{
+    return (RCC_CSR & RCC_CSR_LSIRDY) != 0;
+}
+
+uint32_t os_power_stop(uint32_t ms)
+{
+    if(ms == 0) return 0;
+    if(ms > 0xFFFFUL) ms = 0xFFFFUL; /*ARR is 16 bit: ~65 s per entry*/
+
+    /*Arm the one-shot wakeup. ARR must be written with the LPTIM enabled.*/
+    LPTIM2_ICR = LPTIM_ICR_ALL;
+    LPTIM2_CR = LPTIM_CR_ENABLE;
+    LPTIM2_ARR = ms;
+    LPTIM2_CR = LPTIM_CR_ENABLE | LPTIM_CR_SNGSTRT;
+
+    /*DStop: deep sleep with every PDDS bit clear, low power regulator*/
+    PWR_CPUCR &= ~PWR_CPUCR_PDDS_ALL;
+    PWR_CR1 |= PWR_CR1_LPDS;
+    SCB_SCR |= SCB_SCR_SLEEPDEEP;
+
+    OS_POWER_WFI();
+
+    SCB_SCR &= ~SCB_SCR_SLEEPDEEP;
+
+    /*The counter clock is asynchronous to the bus: read until stable*/
+    uint32_t slept = LPTIM2_CNT;
+    while(slept != LPTIM2_CNT) slept = LPTIM2_CNT;
+    if(LPTIM2_ISR & LPTIM_ISR_ARRM) slept = ms; /*Ran to the deadline*/
+
+    LPTIM2_ICR = LPTIM_ICR_ALL;
+    LPTIM2_CR = 0;
+
+    /*Re-sync the os tick: without this every timer would drift by the
+     *whole STOP duration*/
+    os_tick_inc(slept);
+
+    return slept;
+}
+
+void os_power_lptim_irq_handler(void)
+{
+    LPTIM2_ICR = LPTIM_ICR_ALL;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
@@ -0,0 +1,81 @@
+/**
+ * @file os_power.h
+ * STOP-mode deep sleep between timer deadlines. `os_timer_handler()`
+ * already reports the time till the next ready timer; when that exceeds
+ * a threshold the sleep callback can enter DStop with LPTIM2 (clocked
+ * from the LSI, so it keeps counting while every bus clock is gated) as
+ * the wakeup source, and the os tick is re-synced by the time actually
+ * slept so `os_timer_time_remaining()` stays correct.
+ */
+
+#ifndef OS_POWER_H
+#define OS_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Below this delay STOP is not worth the entry/exit and clock restart
+ *cost: stay with the shallow WFI sleep*/
+#ifndef OS_POWER_STOP_MIN_MS
+#define OS_POWER_STOP_MIN_MS 100
+#endif
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Init the os_power module: start the LSI, feed LPTIM2 from it and
+ * unmask its wakeup line. Call it once after the system clocks are up.
+ * It returns without waiting for the LSI to settle: poll
+ * `os_power_ready` (e.g. as an os_boot ready check) before the first
+ * `os_power_stop`.
+ */
+void os_power_init(void);
+
+/**
+ * Tell whether the LSI settled, i.e. `os_power_stop` may be used
+ * @return true: the wakeup clock is running
+ */
+bool os_power_ready(void);
+
+/**
+ * Enter DStop until `ms` elapsed or any other enabled interrupt fires.
+ * LPTIM2 keeps time while the core and bus clocks are gated; on wakeup
+ * the os tick is advanced by the duration actually slept. The caller
+ * must restore the system clock afterwards (the core wakes on the HSI)
+ * and account any HAL tick it maintains.
+ * @param ms milliseconds to sleep, capped at 65535
+ * @return the milliseconds actually slept (LSI accuracy, ±a few %)
+ */
+uint32_t os_power_stop(uint32_t ms);
+
+/**
+ * Call it from LPTIM2_IRQHandler: clears the autoreload-match flag that
+ * woke the core.
+ */
+void os_power_lptim_irq_handler(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_POWER_H*/
@@ -0,0 +1,77 @@
+/**
+ * @file os_task.c
+ * See os_task.h. A task is an os_timer with period 0 - ready on every
+ * handler pass - whose callback trampolines into the task body; a delay
+ * temporarily raises the period, so the wheel's readiness logic and the
+ * tickless sleep keep working unchanged.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_task.h"
+#include "os_mem.h"
+#include <stddef.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void task_timer_cb(os_timer_t * timer);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+os_task_t * os_task_create(os_task_fn_t fn, void * user_data)
+{
+    os_task_t * task = os_mem_alloc(sizeof(os_task_t));
+    if(task == NULL) return NULL;
+
+    task->fn = fn;
+    task->user_data = user_data;
+    task->lc = 0;
+
+    task->timer = os_timer_create(task_timer_cb, 0, task);
+    if(task->timer == NULL) {
+        os_mem_free(task);
+        return NULL;
+    }
+
+    return task;
+}
+
+void os_task_del(os_task_t * task)
+{
+    os_timer_del(task->timer);
+    os_mem_free(task);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Trampoline from the scheduling timer into the task body
+ * @param timer the timer of the task
+ */
+static void task_timer_cb(os_timer_t * timer)
+{
+    os_task_t * task = timer->user_data;
+    task->fn(task);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file os_task.h
+ * Stackless coroutine-style cooperative tasks on top of os_timer.
+ * A task is straight-line code that can give the CPU back mid-function
+ * with `OS_TASK_YIELD()` / `OS_TASK_DELAY(ms)` and resumes after the same
+ * line on the next pass of `os_timer_handler()`. The continuation point
+ * is one 16 bit line number (a Duff's device switch), so there is no
+ * per-task stack - the memory economy of the timer callbacks stays, the
+ * hand-written state machines go.
+ *
+ * Usage:
+ *    static void flash_erase_task(os_task_t * task)
+ *    {
+ *        OS_TASK_BEGIN(task);
+ *        flash_unlock();
+ *        for(ctx->sector = 0; ctx->sector < 8; ctx->sector++) {
+ *            flash_erase_start(ctx->sector);
+ *            while(flash_busy()) OS_TASK_DELAY(task, 5);
+ *        }
+ *        flash_lock();
+ *        OS_TASK_END(task);
+ *    }
+ * Locals do not survive a yield: keep state in `user_data` (ctx above).
+ * A `switch` statement must not span a yield point.
+ */
+
+#ifndef OS_TASK_H
+#define OS_TASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "os_timer.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+struct _os_task_t;
+
+/**
+ * The body of a task. Called from `os_timer_handler()` whenever the task
+ * is ready; the OS_TASK_* macros make it resume where it left off.
+ */
+typedef void (*os_task_fn_t)(struct _os_task_t * task);
+
+/**
+ * Descriptor of a cooperative task
+ */
+typedef struct _os_task_t {
+    os_timer_t * timer;   /**< The timer that schedules the task*/
+    os_task_fn_t fn;      /**< The task body*/
+    void * user_data;     /**< Task state that must survive yields*/
+    uint16_t lc;          /**< Continuation point (a __LINE__ value)*/
+} os_task_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Create a task. It starts from its first line on the next
+ * `os_timer_handler()` pass and runs until it yields, delays or ends.
+ * @param fn the task body
+ * @param user_data custom parameter stored in the task
+ * @return pointer to the new task
+ */
+os_task_t * os_task_create(os_task_fn_t fn, void * user_data);
+
+/**
+ * Delete a task at any point, also from inside its own body
+ * (`OS_TASK_END` does it implicitly).
+ * @param task pointer to a task
+ */
+void os_task_del(os_task_t * task);
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**
+ * Open the body of a task function. Everything between `OS_TASK_BEGIN`
+ * and `OS_TASK_END` can yield.
+ */
+#define OS_TASK_BEGIN(task) switch((task)->lc) { case 0:
+
+/**
+ * Give the CPU back and resume here on the next handler pass
+ */
+#define OS_TASK_YIELD(task) \
+    do { \
+        (task)->lc = (uint16_t)__LINE__; \
+        return; \
+        case __LINE__:; \
+    } while(0)
+
+/**
+ * Give the CPU back and resume here after at least `ms` milliseconds,
+ * with the same readiness logic as any timer
+ */
+#define OS_TASK_DELAY(task, ms) \
+    do { \
+        (task)->lc = (uint16_t)__LINE__; \
+        os_timer_set_period((task)->timer, ms); \
+        return; \
+        case __LINE__: \
+            os_timer_set_period((task)->timer, 0); \
+    } while(0)
+
+/**
+ * Close the body of a task function: the task is deleted when execution
+ * reaches it
+ */
+#define OS_TASK_END(task) \
+    } \
+    os_task_del(task); \
+    return
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_TASK_H*/
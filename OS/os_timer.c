@@ -9,12 +9,25 @@
 #include "os_ll.h"
 #include "os_mem.h"
 #include "os_hal_tick.h"
+#include "os_work_queue.h"
+#include "os_pool.h"
+#include "os_event.h"
+#include "os_trace.h"
 /*********************
  *      DEFINES
  *********************/
 #define IDLE_MEAS_PERIOD 500 /*[ms]*/
 #define DEF_PERIOD 500
 
+/*Geometry of the hierarchical timer wheel.
+ *Level 0 has 1 ms resolution, every further level is WHEEL_SLOT_CNT times coarser.
+ *4 levels of 64 slots cover 2^24 ms (~4.6 hours); longer deadlines simply
+ *cascade through the top level until they come into range.*/
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOT_CNT (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOT_CNT - 1)
+#define WHEEL_LEVEL_CNT 4
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -22,18 +35,35 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static bool os_timer_exec(os_timer_t * timer);
+static void os_timer_exec(os_timer_t * timer);
 static uint32_t os_timer_time_remaining(os_timer_t * timer);
+static uint32_t timer_cycles(void);
+static void timer_sched_link(os_timer_t ** head_p, os_timer_t * timer);
+static void timer_unsched(os_timer_t * timer);
+static void timer_sched(os_timer_t * timer);
+static void wheel_cascade(uint32_t level, uint32_t slot);
+static void wheel_advance(uint32_t now);
+static uint32_t wheel_next_delay(void);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static bool os_timer_run = false;
 static uint8_t idle_last = 0;
-static bool timer_deleted;
-static bool timer_created;
-
-os_ll_t _os_timer_ll;
+static bool timer_act_deleted;
+static os_sleep_cb_t run_sleep_cb;
+static void (*run_defer_cb)(void); /*One-shot work for the next `os_run` iteration*/
+static os_timer_overrun_cb_t timer_overrun_cb;
+
+/*Slots are doubly linked lists built from the `sched_next`/`sched_pprev`
+ *fields of `os_timer_t`, so (un)scheduling is O(1) pointer surgery.*/
+static OS_FAST_DATA os_timer_t * wheel_slots[WHEEL_LEVEL_CNT][WHEEL_SLOT_CNT];
+static OS_FAST_DATA os_timer_t * ready_head[OS_TIMER_PRIO_CNT]; /*Due timers, one list per tier*/
+static uint32_t low_prio_budget; /*Cycles a pass may spend below HIGH; 0: unlimited*/
+static os_blk_pool_t timer_pool;    /*Fixed-block pool for the timer nodes*/
+static OS_FAST_DATA uint32_t wheel_time;     /*The tick the wheel was last advanced to*/
+
+os_ll_intr_t _os_timer_ll;
 os_timer_t* _os_timer_act;
 /**********************
  *      MACROS
@@ -49,7 +79,16 @@ os_timer_t* _os_timer_act;
  */
 void _os_timer_core_init(void)
 {
-    _os_ll_init(&_os_timer_ll, sizeof(os_timer_t));
+    _os_ll_intr_init(&_os_timer_ll);
+
+    /*Timer creation is the most common allocation in the system: serve it
+     *from a fixed-block pool, off the TLSF path*/
+    os_pool_init(&timer_pool, sizeof(os_timer_t), OS_TIMER_POOL_CNT, true);
+
+    /*Start the cycle counter for the per-timer statistics*/
+    _os_tick_core_init();
+
+    wheel_time = os_tick_get();
 
     /*Initially enable the os_timer handling*/
     os_timer_enable(true);
@@ -59,7 +98,7 @@ void _os_timer_core_init(void)
  * Call it periodically to handle os_timers.
  * @return the time after which it must be called again
  */
-uint32_t os_timer_handler(void)
+OS_HOT_FUNC uint32_t os_timer_handler(void)
 {
     /*Avoid concurrent running of the timer handler*/
     static bool already_running = false;
@@ -86,40 +125,78 @@ uint32_t os_timer_handler(void)
         }
     }
 
-    /*Run all timer from the list*/
-    os_timer_t * next;
-    do {
-        timer_deleted             = false;
-        timer_created             = false;
-        _os_timer_act = _os_ll_get_head(&_os_timer_ll);
-        while(_os_timer_act) {
-            /*The timer might be deleted if it runs only once ('repeat_count = 1')
-             *So get next element until the current is surely valid*/
-            next = _os_ll_get_next(&_os_timer_ll, _os_timer_act);
-
-            if(os_timer_exec(_os_timer_act)) {
-                /*If a timer was created or deleted then this or the next item might be corrupted*/
-                if(timer_created || timer_deleted) {
-                    break;
-                }
+    /*Run the work handed over from interrupt context first: it is latency
+     *sensitive and its callbacks may create or reset timers for this pass*/
+    _os_work_queue_process();
+
+    /*Move every timer whose deadline arrived to the ready list.
+     *Timers further in the future are not touched at all.*/
+    wheel_advance(handler_start);
+
+    /*Ready the timers bound to the events posted since the last pass.
+     *One atomic exchange consumes the word and the walk runs only when at
+     *least one event arrived, so the idle path does not pay for it.*/
+    uint32_t events = _os_event_take();
+    if(events) {
+        os_timer_t * t;
+        for(t = os_timer_get_next(NULL); t; t = os_timer_get_next(t)) {
+            uint32_t hit = t->event_mask & events;
+            if(hit == 0 || t->paused) continue;
+            t->events_pending |= hit;
+            if(t->sched_pprev == NULL) { /*Parked; a second event only adds bits*/
+                t->deadline = handler_start;
+                timer_sched(t);
             }
-
-            _os_timer_act = next; /*Load the next timer*/
         }
-    } while(_os_timer_act);
-
-    uint32_t time_till_next = OS_NO_TIMER_READY;
-    next = _os_ll_get_head(&_os_timer_ll);
-    while(next) {
-        if(!next->paused) {
-            uint32_t delay = os_timer_time_remaining(next);
-            if(delay < time_till_next)
-                time_till_next = delay;
+    }
+
+    /*Take over the ready lists of every tier up front so a timer becoming
+     *ready again while it runs (e.g. a 0 period) waits for the next pass
+     *instead of looping this one. Dispatch by popping the head so no `next`
+     *pointer is cached: the callbacks are free to create or delete any
+     *timer, including ones still on a run list (deletion unlinks in place
+     *via `sched_pprev`). Each ready timer is visited at most once per pass,
+     *never re-walked.*/
+    os_timer_t * run_head[OS_TIMER_PRIO_CNT];
+    uint32_t prio;
+    for(prio = 0; prio < OS_TIMER_PRIO_CNT; prio++) {
+        run_head[prio] = ready_head[prio];
+        ready_head[prio] = NULL;
+        if(run_head[prio]) run_head[prio]->sched_pprev = &run_head[prio];
+    }
+
+    uint32_t pass_start_cycles = timer_cycles();
+
+    for(prio = 0; prio < OS_TIMER_PRIO_CNT; prio++) {
+        while(run_head[prio]) {
+            /*Below the HIGH tier the pass is budget bounded: once the
+             *cycles are spent the rest is carried over to the next pass*/
+            if(prio != OS_TIMER_PRIO_HIGH && low_prio_budget != 0 &&
+               timer_cycles() - pass_start_cycles >= low_prio_budget) break;
+
+            _os_timer_act = run_head[prio];
+            timer_unsched(_os_timer_act);
+            timer_act_deleted = false;
+
+            os_timer_exec(_os_timer_act);
+
+            _os_timer_act = NULL;
         }
 
-        next = _os_ll_get_next(&_os_timer_ll, next); /*Find the next timer*/
+        /*Budget exhausted: put the skipped timers back, ahead of the ones
+         *that became ready during this pass*/
+        if(run_head[prio]) {
+            os_timer_t * tail = run_head[prio];
+            while(tail->sched_next) tail = tail->sched_next;
+            tail->sched_next = ready_head[prio];
+            if(ready_head[prio]) ready_head[prio]->sched_pprev = &tail->sched_next;
+            ready_head[prio] = run_head[prio];
+            ready_head[prio]->sched_pprev = &ready_head[prio];
+        }
     }
 
+    uint32_t time_till_next = wheel_next_delay();
+
     busy_time += os_tick_elaps(handler_start);
     uint32_t idle_period_time = os_tick_elaps(idle_period_start);
     if(idle_period_time >= IDLE_MEAS_PERIOD) {
@@ -133,6 +210,50 @@ uint32_t os_timer_handler(void)
     return time_till_next;
 }
 
+/**
+ * Run the timers in an endless loop. It never returns.
+ * Between two handler passes the sleep callback is called with the time
+ * till the next ready timer, so the core can wait in WFI instead of
+ * busy-spinning.
+ */
+void os_run(void)
+{
+    while(1) {
+        uint32_t delay = os_timer_handler();
+
+        /*Deferred work runs here, outside the handler: it may block for
+         *long and may call os_timer_handler itself*/
+        if(run_defer_cb) {
+            void (*defer_cb)(void) = run_defer_cb;
+            run_defer_cb = NULL;
+            defer_cb();
+            continue; /*It may have created or readied timers*/
+        }
+
+        if(delay > 0 && run_sleep_cb) run_sleep_cb(delay);
+    }
+}
+
+/**
+ * Set the function `os_run()` uses to sleep until the next timer deadline.
+ * The callback is responsible for programming a wakeup source and for
+ * compensating `os_tick_inc()` with the time actually slept.
+ * @param sleep_cb the sleep function or NULL to busy-wait
+ */
+void os_run_set_sleep_cb(os_sleep_cb_t sleep_cb)
+{
+    run_sleep_cb = sleep_cb;
+}
+
+/**
+ * Hand one callback to the next `os_run()` iteration (see os_timer.h).
+ * @param cb the function to call or NULL to cancel
+ */
+void os_run_defer(void (*cb)(void))
+{
+    run_defer_cb = cb;
+}
+
 /**
  * Create an "empty" timer. It needs to initialized with at least
  * `os_timer_set_cb` and `os_timer_set_period`
@@ -156,8 +277,9 @@ os_timer_t * os_timer_create(os_timer_cb_t timer_xcb, uint32_t period, void * us
 {
 	os_timer_t * new_timer = NULL;
 
-    new_timer = _os_ll_ins_head(&_os_timer_ll);
+    new_timer = os_pool_alloc(&timer_pool);
     if(new_timer == NULL) return NULL;
+    _os_ll_intr_ins_head(&_os_timer_ll, &new_timer->ll_node);
 
     new_timer->period = period;
     new_timer->timer_cb = timer_xcb;
@@ -165,8 +287,15 @@ os_timer_t * os_timer_create(os_timer_cb_t timer_xcb, uint32_t period, void * us
     new_timer->paused = 0;
     new_timer->last_run = os_tick_get();
     new_timer->user_data = user_data;
+    new_timer->sched_next = NULL;
+    new_timer->sched_pprev = NULL;
+    new_timer->deadline = new_timer->last_run + period;
+    new_timer->event_mask = 0;
+    new_timer->events_pending = 0;
+    new_timer->prio = OS_TIMER_PRIO_MID;
+    os_memset_00(&new_timer->stats, sizeof(os_timer_stats_t));
 
-    timer_created = true;
+    timer_sched(new_timer);
 
     return new_timer;
 }
@@ -187,10 +316,11 @@ void os_timer_set_cb(os_timer_t * timer, os_timer_cb_t timer_cb)
  */
 void os_timer_del(os_timer_t * timer)
 {
-    _os_ll_remove(&_os_timer_ll, timer);
-    timer_deleted = true;
+    timer_unsched(timer);
+    _os_ll_intr_remove(&_os_timer_ll, &timer->ll_node);
+    if(timer == _os_timer_act) timer_act_deleted = true;
 
-    os_mem_free(timer);
+    os_pool_free(&timer_pool, timer);
 }
 
 /**
@@ -199,12 +329,16 @@ void os_timer_del(os_timer_t * timer)
  */
 void os_timer_pause(os_timer_t * timer)
 {
+    timer_unsched(timer);
     timer->paused = true;
 }
 
 void os_timer_resume(os_timer_t * timer)
 {
+    if(!timer->paused) return; /*Resuming a running timer must not schedule it twice*/
     timer->paused = false;
+    timer->deadline = os_tick_get() + os_timer_time_remaining(timer);
+    timer_sched(timer);
 }
 
 /**
@@ -215,6 +349,10 @@ void os_timer_resume(os_timer_t * timer)
 void os_timer_set_period(os_timer_t * timer, uint32_t period)
 {
     timer->period = period;
+    if(timer->paused) return;
+    timer_unsched(timer);
+    timer->deadline = timer->last_run + period;
+    timer_sched(timer);
 }
 
 /**
@@ -224,6 +362,65 @@ void os_timer_set_period(os_timer_t * timer, uint32_t period)
 void os_timer_ready(os_timer_t * timer)
 {
     timer->last_run = os_tick_get() - timer->period - 1;
+    if(timer->paused) return;
+    timer_unsched(timer);
+    timer->deadline = os_tick_get();
+    timer_sched(timer);
+}
+
+/**
+ * Set the priority tier of a timer
+ * @param timer pointer to a os_timer
+ * @param prio `OS_TIMER_PRIO_HIGH/MID/LOW`
+ */
+void os_timer_set_prio(os_timer_t * timer, uint8_t prio)
+{
+    if(prio >= OS_TIMER_PRIO_CNT) prio = OS_TIMER_PRIO_LOW;
+
+    /*Move the timer to the matching ready list if it is due already*/
+    bool scheduled = timer->sched_pprev != NULL;
+    if(scheduled) timer_unsched(timer);
+    timer->prio = prio;
+    if(scheduled) timer_sched(timer);
+}
+
+/**
+ * Bound the time a handler pass may spend below `OS_TIMER_PRIO_HIGH`
+ * @param cycles the budget in CPU cycles per pass; 0: unlimited
+ */
+void os_timer_set_low_prio_budget(uint32_t cycles)
+{
+    low_prio_budget = cycles;
+}
+
+/**
+ * Bind a timer to event bits (see os_event.h). A bound timer leaves the
+ * wheel and runs only when an ISR posts at least one of the masked bits.
+ * @param timer pointer to a os_timer
+ * @param event_mask the event bits that ready the timer; 0 unbinds it
+ */
+void os_timer_bind_event(os_timer_t * timer, uint32_t event_mask)
+{
+    timer->event_mask = event_mask;
+    timer->events_pending = 0;
+    timer_unsched(timer);
+
+    if(event_mask == 0 && !timer->paused) {
+        timer->deadline = os_tick_get() + timer->period;
+        timer_sched(timer);
+    }
+}
+
+/**
+ * Get and clear the event bits that made a bound timer ready
+ * @param timer pointer to a os_timer
+ * @return the pending event bits
+ */
+uint32_t os_timer_get_events(os_timer_t * timer)
+{
+    uint32_t events = timer->events_pending;
+    timer->events_pending = 0;
+    return events;
 }
 
 /**
@@ -244,6 +441,10 @@ void os_timer_set_repeat_count(os_timer_t * timer, int32_t repeat_count)
 void os_timer_reset(os_timer_t * timer)
 {
     timer->last_run = os_tick_get();
+    if(timer->paused) return;
+    timer_unsched(timer);
+    timer->deadline = timer->last_run + timer->period;
+    timer_sched(timer);
 }
 
 /**
@@ -264,6 +465,26 @@ uint8_t os_timer_get_idle(void)
     return idle_last;
 }
 
+/**
+ * Get the execution statistics of a timer
+ * @param timer pointer to an os_timer
+ * @param stats_p pointer to an `os_timer_stats_t` variable,
+ *                the statistics will be copied here
+ */
+void os_timer_get_stats(os_timer_t * timer, os_timer_stats_t * stats_p)
+{
+    *stats_p = timer->stats;
+}
+
+/**
+ * Set a callback to call when any timer runs at least one full period late.
+ * @param overrun_cb the callback or NULL to disable
+ */
+void os_timer_set_overrun_cb(os_timer_overrun_cb_t overrun_cb)
+{
+    timer_overrun_cb = overrun_cb;
+}
+
 /**
  * Iterate through the timers
  * @param timer NULL to start iteration or the previous return value to get the next timer
@@ -271,8 +492,9 @@ uint8_t os_timer_get_idle(void)
  */
 os_timer_t * os_timer_get_next(os_timer_t * timer)
 {
-    if(timer == NULL) return _os_ll_get_head(&_os_timer_ll);
-    else return _os_ll_get_next(&_os_timer_ll, timer);
+    /*`ll_node` is the first field so the node address is the timer address*/
+    if(timer == NULL) return (os_timer_t *)_os_ll_intr_get_head(&_os_timer_ll);
+    else return (os_timer_t *)timer->ll_node.next;
 }
 
 /**********************
@@ -280,33 +502,54 @@ os_timer_t * os_timer_get_next(os_timer_t * timer)
  **********************/
 
 /**
- * Execute timer if its remaining time is zero
+ * Execute a ready timer and schedule it again for its next period
  * @param timer pointer to os_timer
- * @return true: execute, false: not executed
- */
-static bool os_timer_exec(os_timer_t * timer)
-{
-    if(timer->paused) return false;
-
-    bool exec = false;
-    if(os_timer_time_remaining(timer) == 0) {
-        /* Decrement the repeat count before executing the timer_cb.
-         * If any timer is deleted `if(timer->repeat_count == 0)` is not executed below
-         * but at least the repeat count is zero and the timer can be deleted in the next round*/
-        int32_t original_repeat_count = timer->repeat_count;
-        if(timer->repeat_count > 0) timer->repeat_count--;
-        timer->last_run = os_tick_get();
-        if(timer->timer_cb && original_repeat_count != 0) timer->timer_cb(timer);
-        exec = true;
+ */
+static OS_HOT_FUNC void os_timer_exec(os_timer_t * timer)
+{
+    if(timer->paused) return;
+
+    /*Count the periods that were skipped because the handler ran late.
+     *The offender is an earlier callback of this pass, not this timer, but
+     *this is where the damage becomes visible.*/
+    uint32_t late = os_tick_get() - timer->deadline;
+    if((int32_t)late > 0 && timer->period && late >= timer->period) {
+        timer->stats.overrun_cnt += late / timer->period;
+        if(timer_overrun_cb) timer_overrun_cb(timer, late);
     }
 
-    if(timer_deleted == false) { /*The timer might be deleted by itself as well*/
-        if(timer->repeat_count == 0) { /*The repeat count is over, delete the timer*/
-        	os_timer_del(timer);
-        }
+    /* Decrement the repeat count before executing the timer_cb.
+     * If any timer is deleted `if(timer->repeat_count == 0)` is not executed below
+     * but at least the repeat count is zero and the timer can be deleted in the next round*/
+    int32_t original_repeat_count = timer->repeat_count;
+    if(timer->repeat_count > 0) timer->repeat_count--;
+    timer->last_run = os_tick_get();
+    /*The callback may delete its own timer: keep it local for the traces*/
+    os_timer_cb_t timer_cb = timer->timer_cb;
+    uint32_t start_cycles = timer_cycles();
+    OS_TRACE_ADD(OS_TRACE_EVT_TIMER_ENTER, (uintptr_t)timer_cb);
+    if(timer_cb && original_repeat_count != 0) timer_cb(timer);
+    OS_TRACE_ADD(OS_TRACE_EVT_TIMER_EXIT, (uintptr_t)timer_cb);
+    uint32_t exec_cycles = timer_cycles() - start_cycles;
+
+    if(timer_act_deleted) return; /*The timer deleted itself in the callback*/
+
+    timer->stats.last_cycles = exec_cycles;
+    if(exec_cycles > timer->stats.max_cycles) timer->stats.max_cycles = exec_cycles;
+    timer->stats.total_cycles += exec_cycles;
+    timer->stats.run_cnt++;
+
+    if(timer->repeat_count == 0) { /*The repeat count is over, delete the timer*/
+        os_timer_del(timer);
+        return;
     }
 
-    return exec;
+    /*Arm for the next period unless the callback re-scheduled it already.
+     *Event-bound timers stay parked: only `os_event_set` readies them.*/
+    if(timer->sched_pprev == NULL && !timer->paused && timer->event_mask == 0) {
+        timer->deadline = timer->last_run + timer->period;
+        timer_sched(timer);
+    }
 }
 
 /**
@@ -322,3 +565,143 @@ static uint32_t os_timer_time_remaining(os_timer_t * timer)
         return 0;
     return timer->period - elp;
 }
+
+/**
+ * Read the cycle counter for the statistics. Calling it every pass also
+ * services the wrap around extension of `os_tick_get_cycles`.
+ * @return the current cycle count (truncated, only deltas are used)
+ */
+static uint32_t timer_cycles(void)
+{
+    return (uint32_t)os_tick_get_cycles();
+}
+
+/**
+ * Push a timer to the front of a wheel slot or the ready list
+ * @param head_p pointer to the list head pointer
+ * @param timer pointer to os_timer
+ */
+static OS_HOT_FUNC void timer_sched_link(os_timer_t ** head_p, os_timer_t * timer)
+{
+    timer->sched_next = *head_p;
+    if(*head_p) (*head_p)->sched_pprev = &timer->sched_next;
+    *head_p = timer;
+    timer->sched_pprev = head_p;
+}
+
+/**
+ * Unlink a timer from whatever wheel slot or ready list it is in
+ * @param timer pointer to os_timer
+ */
+static OS_HOT_FUNC void timer_unsched(os_timer_t * timer)
+{
+    if(timer->sched_pprev == NULL) return; /*Not scheduled*/
+
+    *timer->sched_pprev = timer->sched_next;
+    if(timer->sched_next) timer->sched_next->sched_pprev = timer->sched_pprev;
+    timer->sched_next = NULL;
+    timer->sched_pprev = NULL;
+}
+
+/**
+ * Place a timer into the wheel slot matching its deadline.
+ * Already elapsed deadlines go straight to the ready list.
+ * @param timer pointer to os_timer
+ */
+static OS_HOT_FUNC void timer_sched(os_timer_t * timer)
+{
+    uint32_t delta = timer->deadline - wheel_time;
+
+    if(delta == 0 || delta > (uint32_t)INT32_MAX) { /*Due now or already in the past*/
+        timer_sched_link(&ready_head[timer->prio], timer);
+        return;
+    }
+
+    uint32_t level;
+    for(level = 0; level < WHEEL_LEVEL_CNT - 1; level++) {
+        if(delta < (1UL << ((level + 1) * WHEEL_SLOT_BITS))) break;
+    }
+
+    uint32_t slot = (timer->deadline >> (level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK;
+    timer_sched_link(&wheel_slots[level][slot], timer);
+}
+
+/**
+ * Empty an upper level slot by placing its timers again one level down
+ * @param level the level of the slot [1..WHEEL_LEVEL_CNT-1]
+ * @param slot the slot index to cascade
+ */
+static OS_HOT_FUNC void wheel_cascade(uint32_t level, uint32_t slot)
+{
+    os_timer_t * timer = wheel_slots[level][slot];
+    while(timer) {
+        os_timer_t * next = timer->sched_next;
+        timer_unsched(timer);
+        timer_sched(timer);
+        timer = next;
+    }
+}
+
+/**
+ * Advance the wheel to the current tick, expiring due slots to the ready list
+ * @param now the current tick (from `os_tick_get()`)
+ */
+static OS_HOT_FUNC void wheel_advance(uint32_t now)
+{
+    while((int32_t)(now - wheel_time) > 0) {
+        wheel_time++;
+
+        uint32_t slot = wheel_time & WHEEL_SLOT_MASK;
+        if(slot == 0) {
+            /*A level wrapped around: pull the next upper slot(s) down*/
+            uint32_t level;
+            for(level = 1; level < WHEEL_LEVEL_CNT; level++) {
+                uint32_t up_slot = (wheel_time >> (level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK;
+                wheel_cascade(level, up_slot);
+                if(up_slot != 0) break;
+            }
+        }
+
+        /*Everything in the level 0 slot of this tick is due right now*/
+        os_timer_t * timer = wheel_slots[0][slot];
+        while(timer) {
+            os_timer_t * next = timer->sched_next;
+            timer_unsched(timer);
+            timer_sched_link(&ready_head[timer->prio], timer);
+            timer = next;
+        }
+    }
+}
+
+/**
+ * Compute the delay until the wheel needs attention again.
+ * For upper levels the cascade time of the slot is used which is never
+ * later than any deadline stored in it.
+ * @return the delay in ms or OS_NO_TIMER_READY if no timer is scheduled
+ */
+static OS_HOT_FUNC uint32_t wheel_next_delay(void)
+{
+    uint32_t prio;
+    for(prio = 0; prio < OS_TIMER_PRIO_CNT; prio++) {
+        if(ready_head[prio]) return 0; /*Carried over timers keep the pass going*/
+    }
+
+    uint32_t best = OS_NO_TIMER_READY;
+    uint32_t level;
+    for(level = 0; level < WHEEL_LEVEL_CNT; level++) {
+        uint32_t cur = (wheel_time >> (level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK;
+        uint32_t i;
+        for(i = 1; i <= WHEEL_SLOT_CNT; i++) {
+            uint32_t slot = (cur + i) & WHEEL_SLOT_MASK;
+            if(wheel_slots[level][slot] == NULL) continue;
+
+            /*The tick when `slot` comes up at this level*/
+            uint32_t delay = (i << (level * WHEEL_SLOT_BITS)) -
+                             (wheel_time & ((1UL << (level * WHEEL_SLOT_BITS)) - 1));
+            if(delay < best) best = delay;
+            break; /*Further slots of this level are later*/
+        }
+    }
+
+    return best;
+}
@@ -22,6 +22,18 @@ extern "C" {
  *********************/
 #define OS_NO_TIMER_READY 0xFFFFFFFF
 
+/*Timer nodes come from a fixed-block pool of this many entries; creation
+ *past that falls back to the general heap (see os_pool.h)*/
+#ifndef OS_TIMER_POOL_CNT
+#define OS_TIMER_POOL_CNT 16
+#endif
+
+/*Priority tiers, see `os_timer_set_prio`. Lower value runs first.*/
+#define OS_TIMER_PRIO_HIGH 0
+#define OS_TIMER_PRIO_MID  1 /*The default*/
+#define OS_TIMER_PRIO_LOW  2
+#define OS_TIMER_PRIO_CNT  3
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -32,16 +44,46 @@ struct _os_timer_t;
  */
 typedef void (*os_timer_cb_t)(struct _os_timer_t *);
 
+/**
+ * `os_run()` calls this type of function to sleep until the next timer deadline.
+ */
+typedef void (*os_sleep_cb_t)(uint32_t ms);
+
+/**
+ * Called when a timer ran at least one full period late.
+ * `late` is the delay past the deadline in ms.
+ */
+typedef void (*os_timer_overrun_cb_t)(struct _os_timer_t * timer, uint32_t late);
+
+/**
+ * Execution statistics of a timer, measured with the DWT cycle counter.
+ */
+typedef struct {
+    uint64_t total_cycles;  /**< Accumulated cycles of all callback runs*/
+    uint32_t last_cycles;   /**< Cycles spent in the last callback run*/
+    uint32_t max_cycles;    /**< Worst case cycles of a single run*/
+    uint32_t run_cnt;       /**< Number of callback runs*/
+    uint32_t overrun_cnt;   /**< Periods missed because the handler was late*/
+} os_timer_stats_t;
+
 /**
  * Descriptor of a os_timer
  */
 typedef struct _os_timer_t {
+    os_ll_intr_node_t ll_node; /**< Links of the timer list. Must stay the first field*/
     uint32_t period; /**< How often the timer should run*/
     uint32_t last_run; /**< Last time the timer ran*/
     os_timer_cb_t timer_cb; /**< Timer function*/
     void * user_data; /**< Custom user data*/
     int32_t repeat_count; /**< 1: One time;  -1 : infinity;  n>0: residual times*/
+    uint32_t deadline; /**< Absolute tick when the timer is due (last_run + period)*/
+    struct _os_timer_t * sched_next; /**< Next timer in the same wheel slot or in the ready list*/
+    struct _os_timer_t ** sched_pprev; /**< Address of the previous link; NULL if not scheduled*/
+    os_timer_stats_t stats; /**< Execution statistics, see `os_timer_get_stats`*/
+    uint32_t event_mask; /**< Run only when one of these event bits is posted; 0: periodic (see `os_timer_bind_event`)*/
+    uint32_t events_pending; /**< Event bits that readied the timer, consumed by `os_timer_get_events`*/
     uint32_t paused : 1;
+    uint32_t prio : 2; /**< Priority tier, one of `OS_TIMER_PRIO_...`*/
 } os_timer_t;
 
 /**********************
@@ -63,6 +105,33 @@ uint32_t  os_timer_handler(void);
 
 //! @endcond
 
+/**
+ * Run the timers in an endless loop. It never returns.
+ * Between two handler passes the sleep callback set with
+ * `os_run_set_sleep_cb` is called with the time till the next ready timer,
+ * so the core can wait in WFI instead of busy-spinning.
+ */
+void os_run(void);
+
+/**
+ * Set the function `os_run()` uses to sleep until the next timer deadline.
+ * The callback is responsible for programming a wakeup source and for
+ * compensating `os_tick_inc()` with the time actually slept.
+ * @param sleep_cb the sleep function or NULL to busy-wait
+ */
+void os_run_set_sleep_cb(os_sleep_cb_t sleep_cb);
+
+/**
+ * Run `cb` once from the `os_run()` loop, between two timer handler
+ * passes. Use it for long or blocking work triggered from timer context
+ * (e.g. a boot step callback): inside `os_timer_handler` a nested handler
+ * call only hits the reentry guard and a busy wait stalls the whole pass.
+ * One callback is held at a time; setting a new one before the previous
+ * ran replaces it.
+ * @param cb the function to call or NULL to cancel
+ */
+void os_run_defer(void (*cb)(void));
+
 /**
  * Call it in the super-loop of main() or threads. It will run lv_timer_handler()
  * with a given period in ms. You can use it with sleep or delay in OS environment.
@@ -133,6 +202,46 @@ void os_timer_set_period(os_timer_t * timer, uint32_t period);
  */
 void os_timer_ready(os_timer_t * timer);
 
+/**
+ * Set the priority tier of a timer. `os_timer_handler()` dispatches the
+ * ready timers tier by tier, highest first, so a latency sensitive timer
+ * (e.g. an audio feed) never waits behind a long running bulk one that
+ * merely came earlier in list order. The default is `OS_TIMER_PRIO_MID`.
+ * @param timer pointer to a os_timer
+ * @param prio `OS_TIMER_PRIO_HIGH/MID/LOW`
+ */
+void os_timer_set_prio(os_timer_t * timer, uint8_t prio);
+
+/**
+ * Bound the time a handler pass may spend below `OS_TIMER_PRIO_HIGH`.
+ * Once a pass has consumed this many CPU cycles the remaining ready MID
+ * and LOW timers are carried over to the next pass (which starts
+ * immediately: the sleep hint of the handler is 0 while work is pending).
+ * HIGH tier timers always run.
+ * @param cycles the budget in CPU cycles per pass; 0: unlimited (default)
+ */
+void os_timer_set_low_prio_budget(uint32_t cycles);
+
+/**
+ * Bind a timer to event bits (see os_event.h). A bound timer leaves the
+ * wheel: it no longer runs on its period, only when an ISR posts at least
+ * one of the masked bits with `os_event_set` - then it runs on the next
+ * `os_timer_handler()` pass, like any due timer.
+ * @param timer pointer to a os_timer
+ * @param event_mask the event bits that ready the timer; 0 unbinds it
+ *                   and re-arms the periodic scheduling
+ */
+void os_timer_bind_event(os_timer_t * timer, uint32_t event_mask);
+
+/**
+ * Get and clear the event bits that made a bound timer ready.
+ * Meant to be called from the timer callback to see which of the masked
+ * events fired (more may have accumulated since it was readied).
+ * @param timer pointer to a os_timer
+ * @return the pending event bits
+ */
+uint32_t os_timer_get_events(os_timer_t * timer);
+
 /**
  * Set the number of times a timer will repeat.
  * @param timer pointer to a os_timer.
@@ -159,6 +268,22 @@ void os_timer_enable(bool en);
  */
 uint8_t os_timer_get_idle(void);
 
+/**
+ * Get the execution statistics of a timer
+ * @param timer pointer to an os_timer
+ * @param stats_p pointer to an `os_timer_stats_t` variable,
+ *                the statistics will be copied here
+ */
+void os_timer_get_stats(os_timer_t * timer, os_timer_stats_t * stats_p);
+
+/**
+ * Set a callback to call when any timer runs at least one full period late.
+ * It is called before the timer callback itself, so the offender can be
+ * logged (e.g. over UART) in production.
+ * @param overrun_cb the callback or NULL to disable
+ */
+void os_timer_set_overrun_cb(os_timer_overrun_cb_t overrun_cb);
+
 /**
  * Iterate through the timers
  * @param timer NULL to start iteration or the previous return value to get the next timer
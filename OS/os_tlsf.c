@@ -2,7 +2,22 @@
 #include "os_tlsf.h"
 #include "os_mem.h"
 
-#define TLSF_MAX_POOL_SIZE OS_MEM_SIZE
+/*
+** Compile-time sizing (see os_tlsf.h). The largest supported pool bounds
+** the first-level index depth, the second-level subdivisions the width:
+** together they set the size of the control structure (os_tlsf_size()).
+*/
+#ifndef OS_TLSF_MAX_POOL_SIZE
+#define OS_TLSF_MAX_POOL_SIZE OS_MEM_POOL_MAX_SIZE
+#endif
+#ifndef OS_TLSF_SL_INDEX_COUNT_LOG2
+#define OS_TLSF_SL_INDEX_COUNT_LOG2 5
+#endif
+#ifndef OS_TLSF_CHECK_HEADERS
+#define OS_TLSF_CHECK_HEADERS 1
+#endif
+
+#define TLSF_MAX_POOL_SIZE OS_TLSF_MAX_POOL_SIZE
 #define TLSF_FLS(n) TLSF_FLS32(n)
 
 
@@ -42,7 +57,7 @@ enum tlsf_public {
     ** values require more memory in the control structure. Values of
     ** 4 or 5 are typical.
     */
-    SL_INDEX_COUNT_LOG2 = 5,
+    SL_INDEX_COUNT_LOG2 = OS_TLSF_SL_INDEX_COUNT_LOG2,
 };
 
 /* Private constants: do not modify. */
@@ -97,6 +112,9 @@ tlsf_static_assert(sizeof(unsigned int) * CHAR_BIT >= SL_INDEX_COUNT);
 /* Ensure we've properly tuned our sizes. */
 tlsf_static_assert(ALIGN_SIZE == SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
 
+/* The configured pool bound must leave at least one first-level list. */
+tlsf_static_assert(TLSF_MAX_POOL_SIZE >= SMALL_BLOCK_SIZE);
+
 /*
 ** Data structures and associated constants.
 */
@@ -118,6 +136,11 @@ typedef struct block_header_t {
     /* The size of this block, excluding the block header. */
     size_t size;
 
+#if OS_TLSF_CHECK_HEADERS
+    /* Checksum of the header, verified when the block is freed. */
+    size_t checksum;
+#endif
+
     /* Next and previous free blocks. */
     struct block_header_t * next_free;
     struct block_header_t * prev_free;
@@ -135,12 +158,29 @@ static const size_t block_header_prev_free_bit = 1 << 1;
 /*
 ** The size of the block header exposed to used blocks is the size field.
 ** The prev_phys_block field is stored *inside* the previous free block.
+** This is the traversal offset (`block_next` lands on the next header at
+** `ptr + size - block_header_overhead`) and it must stay one word even
+** with the checksum enabled: only prev_phys_block may overlay the
+** payload tail, never the next header's size field.
 */
 static const size_t block_header_overhead = sizeof(size_t);
 
+#if OS_TLSF_CHECK_HEADERS
+/* Physical memory a block consumes beyond its payload: the size and the
+** checksum words. Used for the size accounting (split/absorb/overhead
+** reporting), as opposed to the traversal offset above. */
+static const size_t block_phys_overhead = 2 * sizeof(size_t);
+
+/* User data starts after the size and checksum fields in a used block. */
+static const size_t block_start_offset =
+    offsetof(block_header_t, size) + 2 * sizeof(size_t);
+#else
+static const size_t block_phys_overhead = sizeof(size_t);
+
 /* User data starts directly after the size field in a used block. */
 static const size_t block_start_offset =
     offsetof(block_header_t, size) + sizeof(size_t);
+#endif
 
 /*
 ** A free block must be large enough to store its header minus the size of
@@ -163,6 +203,15 @@ typedef struct control_t {
 
     /* Head of free lists. */
     block_header_t * blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+    /* Incrementally maintained statistics, see os_tlsf_get_stats. */
+    size_t free_cnt;
+    size_t free_size;
+    size_t used_cnt;
+
+    /* Cursor of the incremental checker, see os_tlsf_check_step. */
+    int check_fl;
+    int check_sl;
 } control_t;
 
 /* A type used for casting when doing pointer arithmetic. */
@@ -218,6 +267,29 @@ static void block_set_prev_used(block_header_t * block)
     block->size &= ~block_header_prev_free_bit;
 }
 
+#if OS_TLSF_CHECK_HEADERS
+/*
+** Checksum of the header fields that must not change while the block is
+** used. The prev_free bit is excluded: the previous neighbor toggles it
+** legitimately behind the block's back.
+*/
+static size_t block_checksum_calc(const block_header_t * block)
+{
+    return (block->size & ~block_header_prev_free_bit) ^
+           tlsf_cast(size_t, block) ^ tlsf_cast(size_t, 0xC3A5C3A5UL);
+}
+
+static void block_checksum_update(block_header_t * block)
+{
+    block->checksum = block_checksum_calc(block);
+}
+
+static int block_checksum_ok(const block_header_t * block)
+{
+    return block->checksum == block_checksum_calc(block);
+}
+#endif
+
 static block_header_t * block_from_ptr(const void * ptr)
 {
     return tlsf_cast(block_header_t *,
@@ -377,6 +449,9 @@ static void remove_free_block(control_t * control, block_header_t * block, int f
     next->prev_free = prev;
     prev->next_free = next;
 
+    control->free_cnt--;
+    control->free_size -= block_size(block);
+
     /* If this block is the head of the free list, set new head. */
     if(control->blocks[fl][sl] == block) {
         control->blocks[fl][sl] = next;
@@ -408,6 +483,9 @@ static void insert_free_block(control_t * control, block_header_t * block, int f
     control->blocks[fl][sl] = block;
     control->fl_bitmap |= (1U << fl);
     control->sl_bitmap[fl] |= (1U << sl);
+
+    control->free_cnt++;
+    control->free_size += block_size(block);
 }
 
 /* Remove a given block from the free list. */
@@ -428,7 +506,10 @@ static void block_insert(control_t * control, block_header_t * block)
 
 static int block_can_split(block_header_t * block, size_t size)
 {
-    return block_size(block) >= sizeof(block_header_t) + size;
+    /*The remainder must hold a whole free block header: with the checksum
+     *enabled the margin grows by the checksum word*/
+    return block_size(block) >= sizeof(block_header_t) + size +
+           (block_phys_overhead - block_header_overhead);
 }
 
 /* Split a block into two, the second of which is free. */
@@ -438,6 +519,10 @@ static block_header_t * block_split(block_header_t * block, size_t size)
     block_header_t * remaining =
         offset_to_block(block_to_ptr(block), size - block_header_overhead);
 
+    const size_t remain_size = block_size(block) - (size + block_phys_overhead);
+
+    block_set_size(remaining, remain_size);
+
     block_set_size(block, size);
     block_mark_as_free(remaining);
 
@@ -448,7 +533,7 @@ static block_header_t * block_split(block_header_t * block, size_t size)
 static block_header_t * block_absorb(block_header_t * prev, block_header_t * block)
 {
     /* Note: Leaves flags untouched. */
-    prev->size += block_size(block) + block_header_overhead;
+    prev->size += block_size(block) + block_phys_overhead;
     block_link_next(prev);
     return prev;
 }
@@ -498,6 +583,9 @@ static void block_trim_used(control_t * control, block_header_t * block, size_t
         remaining_block = block_merge_next(control, remaining_block);
         block_insert(control, remaining_block);
     }
+#if OS_TLSF_CHECK_HEADERS
+    block_checksum_update(block); /*The in-place realloc changed the size*/
+#endif
 }
 
 static block_header_t * block_trim_free_leading(control_t * control, block_header_t * block, size_t size)
@@ -505,7 +593,7 @@ static block_header_t * block_trim_free_leading(control_t * control, block_heade
     block_header_t * remaining_block = block;
     if(block_can_split(block, size)) {
         /* We want the 2nd block. */
-        remaining_block = block_split(block, size - block_header_overhead);
+        remaining_block = block_split(block, size - block_phys_overhead);
         block_set_prev_free(remaining_block);
 
         block_link_next(block);
@@ -547,6 +635,10 @@ static void * block_prepare_used(control_t * control, block_header_t * block, si
     if(block) {
         block_trim_free(control, block, size);
         block_mark_as_used(block);
+        control->used_cnt++;
+#if OS_TLSF_CHECK_HEADERS
+        block_checksum_update(block);
+#endif
         p = block_to_ptr(block);
     }
     return p;
@@ -560,6 +652,13 @@ static void control_constructor(control_t * control)
     control->block_null.next_free = &control->block_null;
     control->block_null.prev_free = &control->block_null;
 
+    control->free_cnt  = 0;
+    control->free_size = 0;
+    control->used_cnt  = 0;
+
+    control->check_fl = 0;
+    control->check_sl = 0;
+
     control->fl_bitmap = 0;
     for(i = 0; i < FL_INDEX_COUNT; ++i) {
         control->sl_bitmap[i] = 0;
@@ -618,6 +717,64 @@ int os_tlsf_check(os_tlsf_t tlsf)
     return status;
 }
 
+/*
+** Incremental variant of os_tlsf_check: validates free-list buckets from
+** a cursor kept in the control structure, consuming roughly `max_blocks`
+** blocks per call, and wraps around at the end. Driving it from a
+** low-priority timer scrubs the whole structure over many passes with a
+** bounded cost per pass, instead of milliseconds of blockage at once.
+** A started bucket is always finished, so one pass can exceed the budget
+** by the longest free list.
+*/
+int os_tlsf_check_step(os_tlsf_t tlsf, int max_blocks)
+{
+    control_t * control = tlsf_cast(control_t *, tlsf);
+    int status = 0;
+    int budget = max_blocks > 0 ? max_blocks : 1;
+
+    while(budget > 0) {
+        const int i = control->check_fl;
+        const int j = control->check_sl;
+        const block_header_t * block = control->blocks[i][j];
+
+        /* The bitmaps must agree with the list being empty or not. */
+        if(block == &control->block_null) {
+            if(control->sl_bitmap[i] & (1U << j)) status--;
+        }
+        else {
+            if(!(control->fl_bitmap & (1U << i))) status--;
+            if(!(control->sl_bitmap[i] & (1U << j))) status--;
+        }
+
+        while(block != &control->block_null) {
+            int fli, sli;
+            if(!block_is_free(block)) status--;          /* Must be free */
+            if(block_is_prev_free(block)) status--;      /* Should have coalesced */
+            if(block_size(block) < block_size_min) status--;
+            mapping_insert(block_size(block), &fli, &sli);
+            if(fli != i || sli != j) status--;           /* In the right list */
+            block = block->next_free;
+            budget--;
+        }
+        budget--; /* An empty bucket costs one unit too, so a sweep terminates */
+
+        /* Advance the cursor; report a completed clean sweep. */
+        control->check_sl++;
+        if(control->check_sl >= SL_INDEX_COUNT) {
+            control->check_sl = 0;
+            control->check_fl++;
+            if(control->check_fl >= FL_INDEX_COUNT) {
+                control->check_fl = 0;
+                return status ? status : 1;
+            }
+        }
+
+        if(status) return status; /* Stop at the first corrupted bucket */
+    }
+
+    return 0;
+}
+
 #undef tlsf_insist
 
 static void default_walker(void * ptr, size_t size, int used, void * user)
@@ -641,7 +798,7 @@ void os_tlsf_walk_pool(os_pool_t pool, os_tlsf_walker walker, void * user)
     }
 }
 
-size_t os_tlsf_block_size(void * ptr)
+OS_HOT_FUNC size_t os_tlsf_block_size(void * ptr)
 {
     size_t size = 0;
     if(ptr) {
@@ -660,6 +817,38 @@ int os_tlsf_check_pool(os_pool_t pool)
     return integ.status;
 }
 
+/*
+** Size class lower bound of the largest free block, found from the
+** first- and second-level bitmaps alone. The real block may be somewhat
+** larger (up to the width of its size class) but never smaller.
+*/
+static size_t biggest_free_size(const control_t * control)
+{
+    if(!control->fl_bitmap) {
+        return 0;
+    }
+
+    const int fl = tlsf_fls(control->fl_bitmap);
+    const int sl = tlsf_fls(control->sl_bitmap[fl]);
+
+    if(fl == 0) {
+        return tlsf_cast(size_t, sl) * (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+    }
+
+    const int fl_log2 = fl + (FL_INDEX_SHIFT - 1);
+    return (tlsf_cast(size_t, 1) << fl_log2) +
+           (tlsf_cast(size_t, sl) << (fl_log2 - SL_INDEX_COUNT_LOG2));
+}
+
+void os_tlsf_get_stats(os_tlsf_t tlsf, os_tlsf_stats_t * stats)
+{
+    const control_t * control = tlsf_cast(control_t *, tlsf);
+    stats->free_cnt          = control->free_cnt;
+    stats->free_size         = control->free_size;
+    stats->free_biggest_size = biggest_free_size(control);
+    stats->used_cnt          = control->used_cnt;
+}
+
 /*
 ** Size of the TLSF structures in a given memory block passed to
 ** os_tlsf_create, equal to the size of a control_t
@@ -691,12 +880,12 @@ size_t os_tlsf_block_size_max(void)
 */
 size_t os_tlsf_pool_overhead(void)
 {
-    return 2 * block_header_overhead;
+    return 2 * block_phys_overhead;
 }
 
 size_t os_tlsf_alloc_overhead(void)
 {
-    return block_header_overhead;
+    return block_phys_overhead;
 }
 
 os_pool_t os_tlsf_add_pool(os_tlsf_t tlsf, void * mem, size_t bytes)
@@ -735,15 +924,27 @@ os_pool_t os_tlsf_add_pool(os_tlsf_t tlsf, void * mem, size_t bytes)
     return mem;
 }
 
-void os_tlsf_remove_pool(os_tlsf_t tlsf, os_pool_t pool)
+int os_tlsf_remove_pool(os_tlsf_t tlsf, os_pool_t pool)
 {
     control_t * control = tlsf_cast(control_t *, tlsf);
     block_header_t * block = offset_to_block(pool, -(int)block_header_overhead);
 
+    /* The pool must have coalesced back to its add_pool shape: one free
+    ** block followed by the used zero-size sentinel. Anything else means
+    ** live allocations and the pool stays. */
+    if(!block_is_free(block)) {
+        return -1;
+    }
+    block_header_t * next = block_next(block);
+    if(block_size(next) != 0 || block_is_free(next)) {
+        return -1;
+    }
+
     int fl = 0, sl = 0;
 
     mapping_insert(block_size(block), &fl, &sl);
     remove_free_block(control, block, fl, sl);
+    return 0;
 }
 
 
@@ -777,7 +978,7 @@ os_pool_t os_tlsf_get_pool(os_tlsf_t tlsf)
     return tlsf_cast(os_pool_t, (char *)tlsf + os_tlsf_size());
 }
 
-void * os_tlsf_malloc(os_tlsf_t tlsf, size_t size)
+OS_HOT_FUNC void * os_tlsf_malloc(os_tlsf_t tlsf, size_t size)
 {
     control_t * control = tlsf_cast(control_t *, tlsf);
     const size_t adjust = adjust_request_size(size, ALIGN_SIZE);
@@ -785,7 +986,7 @@ void * os_tlsf_malloc(os_tlsf_t tlsf, size_t size)
     return block_prepare_used(control, block, adjust);
 }
 
-void * os_tlsf_memalign(os_tlsf_t tlsf, size_t align, size_t size)
+OS_HOT_FUNC void * os_tlsf_memalign(os_tlsf_t tlsf, size_t align, size_t size)
 {
     control_t * control = tlsf_cast(control_t *, tlsf);
     const size_t adjust = adjust_request_size(size, ALIGN_SIZE);
@@ -798,8 +999,16 @@ void * os_tlsf_memalign(os_tlsf_t tlsf, size_t align, size_t size)
     ** the prev_phys_block field is not valid, and we can't simply adjust
     ** the size of that block.
     */
-    const size_t gap_minimum = sizeof(block_header_t);
-    const size_t size_with_gap = adjust_request_size(adjust + align + gap_minimum, align);
+    const size_t gap_minimum = sizeof(block_header_t) +
+                               (block_phys_overhead - block_header_overhead);
+    /*Extra search slack: the gap can exceed gap_minimum by nearly `align`
+     *and the split leaves block_phys_overhead behind, so a minimum sized
+     *request could otherwise land on a block too tight to trim the
+     *leading gap - and an untrimmed gap means a misaligned pointer*/
+    const size_t gap_slack = sizeof(block_header_t *) +
+                             (block_phys_overhead - block_header_overhead);
+    const size_t size_with_gap =
+        adjust_request_size(adjust + align + gap_minimum + gap_slack, align);
 
     /*
     ** If alignment is less than or equals base alignment, we're done.
@@ -837,18 +1046,25 @@ void * os_tlsf_memalign(os_tlsf_t tlsf, size_t align, size_t size)
     return block_prepare_used(control, block, adjust);
 }
 
-size_t os_tlsf_free(os_tlsf_t tlsf, const void * ptr)
+OS_HOT_FUNC size_t os_tlsf_free(os_tlsf_t tlsf, const void * ptr)
 {
     size_t size = 0;
     /* Don't attempt to free a NULL pointer. */
     if(ptr) {
         control_t * control = tlsf_cast(control_t *, tlsf);
         block_header_t * block = block_from_ptr(ptr);
+#if OS_TLSF_CHECK_HEADERS
+        /*A header overwritten since the allocation (buffer underflow,
+         *use after free, double free) must not be walked: the neighbor
+         *links would spread the damage through the whole pool*/
+        if(!block_checksum_ok(block)) return 0;
+#endif
         size = block->size;
         block_mark_as_free(block);
         block = block_merge_prev(control, block);
         block = block_merge_next(control, block);
         block_insert(control, block);
+        control->used_cnt--;
     }
 
     return size;
@@ -867,7 +1083,7 @@ size_t os_tlsf_free(os_tlsf_t tlsf, const void * ptr)
 ** - an extended buffer size will leave the newly-allocated area with
 **   contents undefined
 */
-void * os_tlsf_realloc(os_tlsf_t tlsf, void * ptr, size_t size)
+OS_HOT_FUNC void * os_tlsf_realloc(os_tlsf_t tlsf, void * ptr, size_t size)
 {
     control_t * control = tlsf_cast(control_t *, tlsf);
     void * p = 0;
@@ -885,7 +1101,7 @@ void * os_tlsf_realloc(os_tlsf_t tlsf, void * ptr, size_t size)
         block_header_t * next = block_next(block);
 
         const size_t cursize = block_size(block);
-        const size_t combined = cursize + block_size(next) + block_header_overhead;
+        const size_t combined = cursize + block_size(next) + block_phys_overhead;
         const size_t adjust = adjust_request_size(size, ALIGN_SIZE);
         if(size > cursize && adjust == 0) {
             /* The request is probably too large, fail */
@@ -7,6 +7,22 @@
 extern "C" {
 #endif
 
+/*
+** Compile-time sizing. Define these to shrink the control structure:
+** - OS_TLSF_MAX_POOL_SIZE: the largest pool the allocator must index
+**   (defaults to OS_MEM_POOL_MAX_SIZE). It sets the number of first-level
+**   lists, so a 64 KB bound needs an order of magnitude less control
+**   memory than the default 8 MB one - it matters on DTCM-resident heaps.
+** - OS_TLSF_SL_INDEX_COUNT_LOG2: log2 of the second-level subdivisions
+**   per first-level list (default 5). Each step down halves the list
+**   head array; 4 is a sensible minimum for low fragmentation.
+** os_tlsf_size() reports the resulting control structure size.
+** - OS_TLSF_CHECK_HEADERS (default 1): store a checksum word in every
+**   block header and verify it in os_tlsf_free(), so a header overwritten
+**   by an underflow, a use after free or a double free is caught within
+**   one allocation cycle. Costs one word per allocation.
+*/
+
 /* os_tlsf_t: a TLSF structure. Can contain 1 to N pools. */
 /* os_pool_t: a block of memory that TLSF can manage. */
 typedef void * os_tlsf_t;
@@ -20,7 +36,9 @@ os_pool_t os_tlsf_get_pool(os_tlsf_t tlsf);
 
 /* Add/remove memory pools. */
 os_pool_t os_tlsf_add_pool(os_tlsf_t tlsf, void * mem, size_t bytes);
-void lv_tlsf_remove_pool(os_tlsf_t tlsf, os_pool_t pool);
+/* Detach `pool` from `tlsf`. Refused (nonzero return) unless the pool is
+** a single entirely free block, so live allocations can never be orphaned. */
+int os_tlsf_remove_pool(os_tlsf_t tlsf, os_pool_t pool);
 
 /* malloc/memalign/realloc/free replacements. */
 void * os_tlsf_malloc(os_tlsf_t tlsf, size_t bytes);
@@ -39,12 +57,29 @@ size_t os_tlsf_block_size_max(void);
 size_t os_tlsf_pool_overhead(void);
 size_t os_tlsf_alloc_overhead(void);
 
+/* Statistics maintained incrementally in the alloc/free paths:
+** reading them is O(1), no pool walk. free_biggest_size is the lower
+** bound of the size class of the largest free block (from the bitmaps),
+** never larger than the real block. */
+typedef struct {
+    size_t free_cnt;
+    size_t free_size;
+    size_t free_biggest_size;
+    size_t used_cnt;
+} os_tlsf_stats_t;
+void os_tlsf_get_stats(os_tlsf_t tlsf, os_tlsf_stats_t * stats);
+
 /* Debugging. */
 typedef void (*os_tlsf_walker)(void * ptr, size_t size, int used, void * user);
 void os_tlsf_walk_pool(os_pool_t pool, os_tlsf_walker walker, void * user);
 /* Returns nonzero if any internal consistency check fails. */
 int os_tlsf_check(os_tlsf_t tlsf);
 int os_tlsf_check_pool(os_pool_t pool);
+/* Incremental os_tlsf_check: validates ~max_blocks blocks from an internal
+** cursor and wraps around, so it can run from a low-priority timer with a
+** bounded cost per call. Returns negative on inconsistency, 1 when a call
+** completed a full clean sweep, 0 otherwise. */
+int os_tlsf_check_step(os_tlsf_t tlsf, int max_blocks);
 
 #if defined(__cplusplus)
 };
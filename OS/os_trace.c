@@ -0,0 +1,168 @@
+/**
+ * @file os_trace.c
+ * See os_trace.h. The ring lives in DTCM and the writer is a short
+ * critical section (time stamp, two words, index bump), so recording is
+ * cheap enough to stay enabled in profiling builds. The drain never
+ * blocks: it sends only what `os_uart_tx_free()` can take and leaves the
+ * rest for the next period.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_trace.h"
+
+#if OS_USE_TRACE
+
+#include "os_timer.h"
+#include "os_uart.h"
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TRACE_EVT_MASK (OS_TRACE_EVT_CNT - 1)
+#define TRACE_FRAME_HDR_SIZE 8
+
+/*The raw cycle counter, readable from any context (the 64 bit
+ *`os_tick_get_cycles` is thread-context-only)*/
+#if defined(__arm__)
+#define TRACE_CYCLES() (*(volatile uint32_t *)0xE0001004UL) /*DWT_CYCCNT*/
+#else
+#define TRACE_CYCLES() ((uint32_t)os_tick_get_cycles())
+#endif
+
+#if defined(__arm__)
+#define OS_TRACE_ENTER_CRITICAL()                       \
+    uint32_t _primask;                                  \
+    __asm volatile("mrs %0, primask" : "=r"(_primask)); \
+    __asm volatile("cpsid i" ::: "memory")
+#define OS_TRACE_EXIT_CRITICAL() \
+    __asm volatile("msr primask, %0" :: "r"(_primask) : "memory")
+#else
+#define OS_TRACE_ENTER_CRITICAL()
+#define OS_TRACE_EXIT_CRITICAL()
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void trace_flush_timer_cb(os_timer_t * timer);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static OS_FAST_DATA os_trace_evt_t trace_ring[OS_TRACE_EVT_CNT];
+static volatile uint16_t trace_wr; /*Free running write index*/
+static volatile uint16_t trace_rd; /*Free running read index, drain only*/
+static uint32_t trace_lost;
+static uint16_t trace_seq;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Start the tracing: creates the timer that drains the ring over UART
+ */
+void os_trace_init(void)
+{
+    os_timer_create(trace_flush_timer_cb, OS_TRACE_FLUSH_PERIOD, NULL);
+}
+
+/**
+ * Append a record to the ring
+ * @param type the event type
+ * @param arg the event argument
+ */
+void _os_trace_add(uint16_t type, uint32_t arg)
+{
+    OS_TRACE_ENTER_CRITICAL();
+
+    if((uint16_t)(trace_wr - trace_rd) >= OS_TRACE_EVT_CNT) {
+        trace_lost++;
+        OS_TRACE_EXIT_CRITICAL();
+        return;
+    }
+
+    os_trace_evt_t * e = &trace_ring[trace_wr & TRACE_EVT_MASK];
+    e->cycles = TRACE_CYCLES();
+    e->arg = arg;
+    e->type = type;
+    e->seq = trace_seq++;
+    trace_wr++;
+
+    OS_TRACE_EXIT_CRITICAL();
+}
+
+/**
+ * Drain as many pending records as the UART TX ring can take right now
+ */
+void os_trace_flush(void)
+{
+    uint16_t rd = trace_rd;
+    uint16_t cnt = (uint16_t)(trace_wr - rd);
+    if(cnt == 0) return;
+
+    /*Frames are all-or-nothing: size the payload to the free TX space so
+     *`os_uart_write` can never truncate a record mid-frame*/
+    size_t tx_free = os_uart_tx_free();
+    if(tx_free <= TRACE_FRAME_HDR_SIZE + sizeof(os_trace_evt_t)) return;
+    uint16_t max_cnt = (uint16_t)((tx_free - TRACE_FRAME_HDR_SIZE) / sizeof(os_trace_evt_t));
+    if(cnt > max_cnt) cnt = max_cnt;
+
+    uint16_t payload_len = (uint16_t)(cnt * sizeof(os_trace_evt_t));
+    uint8_t hdr[TRACE_FRAME_HDR_SIZE];
+    hdr[0] = 0xA5;
+    hdr[1] = 0x5A;
+    hdr[2] = (uint8_t)payload_len;
+    hdr[3] = (uint8_t)(payload_len >> 8);
+    hdr[4] = (uint8_t)trace_lost;
+    hdr[5] = (uint8_t)(trace_lost >> 8);
+    hdr[6] = (uint8_t)(trace_lost >> 16);
+    hdr[7] = (uint8_t)(trace_lost >> 24);
+    os_uart_write(hdr, sizeof(hdr));
+
+    /*The records between `rd` and `wr` are stable: the writer drops
+     *instead of overwriting a full ring. At most two contiguous chunks.*/
+    uint16_t idx = rd & TRACE_EVT_MASK;
+    uint16_t chunk = OS_TRACE_EVT_CNT - idx;
+    if(chunk > cnt) chunk = cnt;
+    os_uart_write(&trace_ring[idx], chunk * sizeof(os_trace_evt_t));
+    if(cnt > chunk) os_uart_write(&trace_ring[0], (uint16_t)(cnt - chunk) * sizeof(os_trace_evt_t));
+
+    trace_rd = (uint16_t)(rd + cnt);
+}
+
+/**
+ * Get the number of events dropped because the ring was full
+ * @return the drop count since boot
+ */
+uint32_t os_trace_get_lost_cnt(void)
+{
+    return trace_lost;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Periodic drain of the ring
+ * @param timer unused
+ */
+static void trace_flush_timer_cb(os_timer_t * timer)
+{
+    OS_UNUSED(timer);
+    os_trace_flush();
+}
+
+#endif /*OS_USE_TRACE*/
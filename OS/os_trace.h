@@ -0,0 +1,121 @@
+/**
+ * @file os_trace.h
+ * Compile-time-optional binary trace of scheduler and allocator events.
+ * Hooks in `os_timer_exec()` and the os_mem alloc/free paths append fixed
+ * size records to a ring in DTCM at a cost of a few cycles per event; a
+ * low priority timer drains the ring over the USART2 DMA path in framed
+ * binary form for offline decoding, so a missed deadline in the field can
+ * be reconstructed from what actually ran when.
+ *
+ * Wire format (little endian): every frame is
+ *    0xA5 0x5A | uint16_t payload_len | uint32_t lost_total | payload
+ * where the payload is `payload_len / sizeof(os_trace_evt_t)` records.
+ * `lost_total` counts the events dropped since boot because the ring was
+ * full; gaps can also be seen from the `seq` field of the records.
+ */
+
+#ifndef OS_TRACE_H
+#define OS_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Enable the tracing. When disabled the hooks compile to nothing.*/
+#ifndef OS_USE_TRACE
+#define OS_USE_TRACE 0
+#endif
+
+/*Number of records the ring can hold. Must be a power of two.
+ *256 records are 3 KB of DTCM and cover a few handler passes.*/
+#ifndef OS_TRACE_EVT_CNT
+#define OS_TRACE_EVT_CNT 256
+#endif
+
+/*Period of the draining timer in ms*/
+#ifndef OS_TRACE_FLUSH_PERIOD
+#define OS_TRACE_FLUSH_PERIOD 50
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    OS_TRACE_EVT_TIMER_ENTER = 1, /*arg: the `timer_cb` pointer*/
+    OS_TRACE_EVT_TIMER_EXIT  = 2, /*arg: the `timer_cb` pointer*/
+    OS_TRACE_EVT_MEM_ALLOC   = 3, /*arg: the allocated size in bytes*/
+    OS_TRACE_EVT_MEM_FREE    = 4, /*arg: the freed block size in bytes*/
+    OS_TRACE_EVT_CYCLE_WRAP  = 5, /*arg: the new high word of the 64 bit cycle count*/
+} os_trace_evt_type_t;
+
+/**
+ * One trace record. `cycles` is the raw 32 bit DWT cycle counter; the
+ * decoder extends it to 64 bits from the CYCLE_WRAP records.
+ */
+typedef struct {
+    uint32_t cycles; /**< Time stamp, raw CPU cycles*/
+    uint32_t arg;    /**< Event argument, see `os_trace_evt_type_t`*/
+    uint16_t type;   /**< One of `os_trace_evt_type_t`*/
+    uint16_t seq;    /**< Running event count, to spot drops*/
+} os_trace_evt_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+#if OS_USE_TRACE
+
+/**
+ * Start the tracing: creates the timer that drains the ring over UART.
+ * Call it after `_os_timer_core_init()` and `os_uart_init()`.
+ */
+void os_trace_init(void);
+
+/**
+ * Append a record to the ring. Safe from any context; when the ring is
+ * full the event is dropped and counted. Application code can log its
+ * own markers with type values above the `os_trace_evt_type_t` range.
+ * @param type the event type
+ * @param arg the event argument
+ */
+void _os_trace_add(uint16_t type, uint32_t arg);
+
+/**
+ * Drain as many pending records as the UART TX ring can take right now.
+ * Called by the timer of `os_trace_init`; can also be called directly
+ * (e.g. from a fault handler, before resetting).
+ */
+void os_trace_flush(void);
+
+/**
+ * Get the number of events dropped because the ring was full
+ * @return the drop count since boot
+ */
+uint32_t os_trace_get_lost_cnt(void);
+
+#endif /*OS_USE_TRACE*/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/*The hook the traced modules use: free of cost when tracing is off*/
+#if OS_USE_TRACE
+#define OS_TRACE_ADD(type, arg) _os_trace_add(type, (uint32_t)(arg))
+#else
+#define OS_TRACE_ADD(type, arg) do {} while(0)
+#endif
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_TRACE_H*/
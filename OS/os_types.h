@@ -19,6 +19,18 @@ extern "C" {
  *      DEFINES
  *********************/
 
+/*Place a function in the zero wait state ITCM / its data in the DTCM.
+ *Both are copied there by the Reset_Handler (see the .itcm_text and
+ *.dtcm_data output sections in the linker script). Define OS_NO_TCM to
+ *keep everything in flash/SRAM, e.g. when the TCMs are needed elsewhere.*/
+#if defined(__arm__) && !defined(OS_NO_TCM)
+#define OS_HOT_FUNC  __attribute__((section(".itcm_text")))
+#define OS_FAST_DATA __attribute__((section(".dtcm_data")))
+#else
+#define OS_HOT_FUNC
+#define OS_FAST_DATA
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -0,0 +1,360 @@
+/**
+ * @file os_uart.c
+ * DMA driven, non-blocking driver for USART2 on the STM32H7B3.
+ * The registers are addressed directly so the module stays independent of
+ * the HAL; the HAL init keeps doing the clock/pin/baud setup.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+#include "os_uart.h"
+#include "os_mem.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TX_BUF_MASK (OS_UART_TX_BUF_SIZE - 1)
+
+#if(OS_UART_TX_BUF_SIZE & TX_BUF_MASK) != 0
+#error "OS_UART_TX_BUF_SIZE must be a power of two"
+#endif
+
+/*USART2 registers (RM0455)*/
+#define USART2_BASE 0x40004400UL
+#define USART2_CR1 (*(volatile uint32_t *)(USART2_BASE + 0x00UL))
+#define USART2_CR3 (*(volatile uint32_t *)(USART2_BASE + 0x08UL))
+#define USART2_ISR (*(volatile uint32_t *)(USART2_BASE + 0x1CUL))
+#define USART2_ICR (*(volatile uint32_t *)(USART2_BASE + 0x20UL))
+#define USART2_TDR_ADDR (USART2_BASE + 0x28UL)
+#define USART2_RDR_ADDR (USART2_BASE + 0x24UL)
+
+#define USART_CR1_IDLEIE (1UL << 4)
+#define USART_CR3_DMAR   (1UL << 6)
+#define USART_CR3_DMAT   (1UL << 7)
+#define USART_ISR_IDLE   (1UL << 4)
+#define USART_ICR_IDLECF (1UL << 4)
+
+/*DMA1 streams 0 (TX) and 1 (RX)*/
+#define DMA1_BASE 0x40020000UL
+#define DMA1_LISR  (*(volatile uint32_t *)(DMA1_BASE + 0x00UL))
+#define DMA1_LIFCR (*(volatile uint32_t *)(DMA1_BASE + 0x08UL))
+#define DMA1_S0CR   (*(volatile uint32_t *)(DMA1_BASE + 0x10UL))
+#define DMA1_S0NDTR (*(volatile uint32_t *)(DMA1_BASE + 0x14UL))
+#define DMA1_S0PAR  (*(volatile uint32_t *)(DMA1_BASE + 0x18UL))
+#define DMA1_S0M0AR (*(volatile uint32_t *)(DMA1_BASE + 0x1CUL))
+#define DMA1_S1CR   (*(volatile uint32_t *)(DMA1_BASE + 0x28UL))
+#define DMA1_S1NDTR (*(volatile uint32_t *)(DMA1_BASE + 0x2CUL))
+#define DMA1_S1PAR  (*(volatile uint32_t *)(DMA1_BASE + 0x30UL))
+#define DMA1_S1M0AR (*(volatile uint32_t *)(DMA1_BASE + 0x34UL))
+
+#define DMA_SxCR_EN    (1UL << 0)
+#define DMA_SxCR_TCIE  (1UL << 4)
+#define DMA_SxCR_HTIE  (1UL << 3)
+#define DMA_SxCR_DIR_M2P (1UL << 6) /*Memory to peripheral*/
+#define DMA_SxCR_CIRC  (1UL << 8)
+#define DMA_SxCR_MINC  (1UL << 10)
+
+/*Interrupt flags of stream 0 and 1 in LISR/LIFCR*/
+#define DMA_LISR_TCIF0 (1UL << 5)
+#define DMA_LISR_HTIF1 (1UL << 10)
+#define DMA_LISR_TCIF1 (1UL << 11)
+#define DMA_LIFCR_ALL0 0x3DUL          /*All stream 0 flags*/
+#define DMA_LIFCR_ALL1 (0x3DUL << 6)   /*All stream 1 flags*/
+
+/*DMAMUX1: DMA1 stream x is fed by DMAMUX1 channel x (RM0455)*/
+#define DMAMUX1_BASE 0x40020800UL
+#define DMAMUX1_C0CR (*(volatile uint32_t *)(DMAMUX1_BASE + 0x00UL))
+#define DMAMUX1_C1CR (*(volatile uint32_t *)(DMAMUX1_BASE + 0x04UL))
+#define DMAMUX_REQ_USART2_RX 43UL
+#define DMAMUX_REQ_USART2_TX 44UL
+
+/*DMA1 clock enable and stream interrupts (IRQ 11 and 12)*/
+#define RCC_AHB1ENR (*(volatile uint32_t *)0x58024538UL)
+#define RCC_AHB1ENR_DMA1EN (1UL << 0)
+#define NVIC_ISER0 (*(volatile uint32_t *)0xE000E100UL)
+#define DMA1_STR0_IRQN_BIT (1UL << 11)
+#define DMA1_STR1_IRQN_BIT (1UL << 12)
+
+/*Cortex-M7 cache maintenance by address (32 byte lines)*/
+#define SCB_DCCMVAC  (*(volatile uint32_t *)0xE000EF68UL) /*Clean*/
+#define SCB_DCCIMVAC (*(volatile uint32_t *)0xE000EF70UL) /*Clean & invalidate*/
+#define CACHE_LINE 32UL
+
+#if defined(__arm__)
+#define OS_DSB() __asm volatile("dsb 0xF" ::: "memory")
+#define OS_UART_ENTER_CRITICAL() \
+    uint32_t _primask;           \
+    __asm volatile("mrs %0, primask\n\tcpsid i" : "=r"(_primask))
+#define OS_UART_EXIT_CRITICAL() __asm volatile("msr primask, %0" :: "r"(_primask))
+#else
+#define OS_DSB() do {} while(0)
+#define OS_UART_ENTER_CRITICAL() do {} while(0)
+#define OS_UART_EXIT_CRITICAL()  do {} while(0)
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void tx_kick(void);
+static void rx_deliver(void);
+static void dcache_clean(const void * addr, size_t len);
+static void dcache_clean_invalidate(const void * addr, size_t len);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static uint8_t tx_buf[OS_UART_TX_BUF_SIZE];
+static uint8_t rx_buf[OS_UART_RX_BUF_SIZE];
+
+/*Free running ring indexes, masked on access*/
+static volatile uint32_t tx_head;   /*Producer index, written by `os_uart_write`*/
+static volatile uint32_t tx_tail;   /*Consumer index, written by the DMA interrupt*/
+static volatile uint32_t tx_chunk;  /*Length of the chunk the DMA is sending*/
+static uint32_t tx_drop_cnt;
+
+static uint32_t rx_pos;             /*The ring position processed so far*/
+static os_uart_rx_cb_t rx_cb;
+
+/*Set by `os_uart_init`. Before it the DMA1 clock may still be gated, so
+ *`os_uart_write` (e.g. a printf from an early HAL error path) must not
+ *touch the stream registers.*/
+static volatile bool uart_ready;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Take over USART2 after `MX_USART2_UART_Init()`: route its requests to
+ * DMA1 streams 0 (TX) and 1 (RX), start the circular RX transfer and
+ * enable the idle line interrupt.
+ */
+void os_uart_init(void)
+{
+    RCC_AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+    DMAMUX1_C0CR = DMAMUX_REQ_USART2_TX;
+    DMAMUX1_C1CR = DMAMUX_REQ_USART2_RX;
+
+    /*TX: armed on demand by `tx_kick`*/
+    DMA1_S0CR  = 0;
+    DMA1_S0PAR = USART2_TDR_ADDR;
+
+    /*RX: free running circular transfer into `rx_buf`. The half and full
+     *interrupts deliver segments even without an idle gap on the line.*/
+    DMA1_S1CR   = 0;
+    DMA1_LIFCR  = DMA_LIFCR_ALL1;
+    DMA1_S1PAR  = USART2_RDR_ADDR;
+    DMA1_S1M0AR = (uint32_t)(os_uintptr_t)rx_buf;
+    DMA1_S1NDTR = OS_UART_RX_BUF_SIZE;
+    dcache_clean_invalidate(rx_buf, OS_UART_RX_BUF_SIZE);
+    DMA1_S1CR = DMA_SxCR_CIRC | DMA_SxCR_MINC |
+                DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_EN;
+
+    NVIC_ISER0 = DMA1_STR0_IRQN_BIT | DMA1_STR1_IRQN_BIT;
+
+    USART2_CR3 |= USART_CR3_DMAT | USART_CR3_DMAR;
+    USART2_ICR  = USART_ICR_IDLECF;
+    USART2_CR1 |= USART_CR1_IDLEIE;
+
+    uart_ready = true;
+}
+
+/**
+ * Queue data for transmission and return immediately.
+ * Writes before `os_uart_init` are dropped (and counted): the driver is
+ * brought up by a boot step, not before the main loop.
+ * @param data bytes to send
+ * @param len number of bytes
+ * @return the number of bytes accepted
+ */
+size_t os_uart_write(const void * data, size_t len)
+{
+    if(!uart_ready) {
+        tx_drop_cnt += len;
+        return 0;
+    }
+
+    uint32_t head = tx_head;
+    uint32_t free = OS_UART_TX_BUF_SIZE - (head - tx_tail);
+    if(len > free) {
+        tx_drop_cnt += len - free;
+        len = free;
+    }
+    if(len == 0) return 0;
+
+    /*Copy in up to two parts around the wrap point*/
+    uint32_t idx = head & TX_BUF_MASK;
+    uint32_t first = OS_UART_TX_BUF_SIZE - idx;
+    if(first > len) first = len;
+    os_memcpy_small(&tx_buf[idx], data, first);
+    if(len > first) os_memcpy_small(&tx_buf[0], (const uint8_t *)data + first, len - first);
+
+    /*Publish the bytes before (possibly) starting the DMA on them*/
+    __atomic_store_n(&tx_head, head + len, __ATOMIC_RELEASE);
+
+    /*Start the drain if the stream is idle. The interrupt also calls
+     *`tx_kick`, so only this short window needs masking.*/
+    OS_UART_ENTER_CRITICAL();
+    tx_kick();
+    OS_UART_EXIT_CRITICAL();
+
+    return len;
+}
+
+/**
+ * Get the free space of the TX ring
+ * @return the number of bytes `os_uart_write` can accept right now
+ */
+size_t os_uart_tx_free(void)
+{
+    return OS_UART_TX_BUF_SIZE - (tx_head - tx_tail);
+}
+
+/**
+ * Get the number of TX bytes dropped because the ring was full or the
+ * driver was not initialized yet
+ * @return the drop count since boot
+ */
+uint32_t os_uart_get_tx_drop_cnt(void)
+{
+    return tx_drop_cnt;
+}
+
+/**
+ * Set the callback receiving the RX segments
+ * @param rx_cb_new the callback or NULL to discard received data
+ */
+void os_uart_set_rx_cb(os_uart_rx_cb_t rx_cb_new)
+{
+    rx_cb = rx_cb_new;
+}
+
+/**
+ * Call it from USART2_IRQHandler: handles the idle line interrupt
+ */
+void os_uart_irq_handler(void)
+{
+    if(USART2_ISR & USART_ISR_IDLE) {
+        USART2_ICR = USART_ICR_IDLECF;
+        rx_deliver();
+    }
+}
+
+/**
+ * Call it from DMA1_Stream0_IRQHandler: continues the TX drain
+ */
+void os_uart_tx_dma_irq_handler(void)
+{
+    if((DMA1_LISR & DMA_LISR_TCIF0) == 0) return;
+    DMA1_LIFCR = DMA_LIFCR_ALL0;
+
+    tx_tail += tx_chunk;
+    tx_chunk = 0;
+    tx_kick();
+}
+
+/**
+ * Call it from DMA1_Stream1_IRQHandler: delivers RX segments at the half
+ * and wrap points of the circular buffer
+ */
+void os_uart_rx_dma_irq_handler(void)
+{
+    if((DMA1_LISR & (DMA_LISR_HTIF1 | DMA_LISR_TCIF1)) == 0) return;
+    DMA1_LIFCR = DMA_LIFCR_ALL1;
+    rx_deliver();
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Start the DMA on the next contiguous chunk of the TX ring.
+ * Call with the DMA interrupt masked or from the interrupt itself.
+ */
+static void tx_kick(void)
+{
+    if(tx_chunk) return; /*A chunk is already in flight*/
+
+    uint32_t tail = tx_tail;
+    uint32_t pending = tx_head - tail;
+    if(pending == 0) return;
+
+    uint32_t idx = tail & TX_BUF_MASK;
+    uint32_t chunk = OS_UART_TX_BUF_SIZE - idx; /*Stop at the wrap point*/
+    if(chunk > pending) chunk = pending;
+    tx_chunk = chunk;
+
+    dcache_clean(&tx_buf[idx], chunk);
+
+    DMA1_S0CR   = 0;
+    DMA1_LIFCR  = DMA_LIFCR_ALL0;
+    DMA1_S0M0AR = (uint32_t)(os_uintptr_t)&tx_buf[idx];
+    DMA1_S0NDTR = chunk;
+    DMA1_S0CR   = DMA_SxCR_DIR_M2P | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_EN;
+}
+
+/**
+ * Hand everything the RX DMA wrote since the last call to the callback:
+ * at most two segments when the data wraps around the buffer end
+ */
+static void rx_deliver(void)
+{
+    uint32_t pos = OS_UART_RX_BUF_SIZE - DMA1_S1NDTR;
+    if(pos == rx_pos) return;
+
+    if(rx_cb == NULL) {
+        rx_pos = pos;
+        return;
+    }
+
+    if(pos > rx_pos) {
+        dcache_clean_invalidate(&rx_buf[rx_pos], pos - rx_pos);
+        rx_cb(&rx_buf[rx_pos], pos - rx_pos);
+    }
+    else {
+        dcache_clean_invalidate(&rx_buf[rx_pos], OS_UART_RX_BUF_SIZE - rx_pos);
+        rx_cb(&rx_buf[rx_pos], OS_UART_RX_BUF_SIZE - rx_pos);
+        if(pos) {
+            dcache_clean_invalidate(&rx_buf[0], pos);
+            rx_cb(&rx_buf[0], pos);
+        }
+    }
+
+    rx_pos = pos;
+}
+
+/**
+ * Clean the D-cache lines covering a range (write dirty data to memory)
+ */
+static void dcache_clean(const void * addr, size_t len)
+{
+    uint32_t a = (uint32_t)(os_uintptr_t)addr & ~(CACHE_LINE - 1);
+    uint32_t end = (uint32_t)(os_uintptr_t)addr + len;
+    OS_DSB();
+    for(; a < end; a += CACHE_LINE) SCB_DCCMVAC = a;
+    OS_DSB();
+}
+
+/**
+ * Clean and invalidate the D-cache lines covering a range
+ */
+static void dcache_clean_invalidate(const void * addr, size_t len)
+{
+    uint32_t a = (uint32_t)(os_uintptr_t)addr & ~(CACHE_LINE - 1);
+    uint32_t end = (uint32_t)(os_uintptr_t)addr + len;
+    OS_DSB();
+    for(; a < end; a += CACHE_LINE) SCB_DCCIMVAC = a;
+    OS_DSB();
+}
@@ -0,0 +1,115 @@
+/**
+ * @file os_uart.h
+ * DMA driven, non-blocking driver for USART2.
+ * TX: writers copy into a ring buffer and return immediately, the DMA
+ * drains it in the background. RX: circular DMA with idle line detection
+ * delivering zero-copy `{ptr, len}` segments to a callback.
+ */
+
+#ifndef OS_UART_H
+#define OS_UART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Size of the TX ring buffer. Must be a power of two.*/
+#ifndef OS_UART_TX_BUF_SIZE
+#define OS_UART_TX_BUF_SIZE 1024
+#endif
+
+/*Size of the circular RX DMA buffer. It must hold everything that can
+ *arrive between two handler passes.*/
+#ifndef OS_UART_RX_BUF_SIZE
+#define OS_UART_RX_BUF_SIZE 512
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Called with a received segment. The data points into the circular DMA
+ * buffer and is valid only for the duration of the call: consume or copy
+ * it before returning. Runs in interrupt context (idle line or DMA
+ * half/full transfer); defer with `os_work_submit` if needed.
+ */
+typedef void (*os_uart_rx_cb_t)(const uint8_t * data, size_t len);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Take over USART2 after `MX_USART2_UART_Init()`: route its requests to
+ * DMA1 streams 0 (TX) and 1 (RX) through the DMAMUX, start the circular
+ * RX transfer and enable the idle line interrupt.
+ * The baud rate and frame format set by the HAL init are kept.
+ */
+void os_uart_init(void);
+
+/**
+ * Queue data for transmission and return immediately.
+ * Safe from thread context (single writer); the copy into the ring is
+ * lock-free, only starting an idle DMA masks interrupts for a few cycles.
+ * @param data bytes to send
+ * @param len number of bytes
+ * @return the number of bytes accepted (less than `len` if the ring is
+ *         full; the rest is dropped and counted, see `os_uart_get_tx_drop_cnt`)
+ */
+size_t os_uart_write(const void * data, size_t len);
+
+/**
+ * Get the free space of the TX ring
+ * @return the number of bytes `os_uart_write` can accept right now
+ */
+size_t os_uart_tx_free(void);
+
+/**
+ * Get the number of TX bytes dropped because the ring was full
+ * @return the drop count since boot
+ */
+uint32_t os_uart_get_tx_drop_cnt(void);
+
+/**
+ * Set the callback receiving the RX segments
+ * @param rx_cb the callback or NULL to discard received data
+ */
+void os_uart_set_rx_cb(os_uart_rx_cb_t rx_cb);
+
+/**
+ * Call it from USART2_IRQHandler: handles the idle line interrupt and
+ * delivers the pending RX segment.
+ */
+void os_uart_irq_handler(void);
+
+/**
+ * Call it from DMA1_Stream0_IRQHandler: continues the TX drain.
+ */
+void os_uart_tx_dma_irq_handler(void);
+
+/**
+ * Call it from DMA1_Stream1_IRQHandler: delivers RX segments when the
+ * circular buffer passed its half or wrap point without an idle gap.
+ */
+void os_uart_rx_dma_irq_handler(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_UART_H*/
@@ -0,0 +1,112 @@
+/**
+ * @file os_work_queue.c
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "os_work_queue.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define WORK_QUEUE_MASK (OS_WORK_QUEUE_SIZE - 1)
+
+#if(OS_WORK_QUEUE_SIZE & WORK_QUEUE_MASK) != 0
+#error "OS_WORK_QUEUE_SIZE must be a power of two"
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    os_work_cb_t cb;
+    void * arg;
+} os_work_entry_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static os_work_entry_t work_ring[OS_WORK_QUEUE_SIZE];
+
+/*The indexes run free and are masked on access, so `tail - head` is the
+ *fill level even across wrap around*/
+static volatile uint32_t work_head; /*Consumer index, written only by the timer loop*/
+static volatile uint32_t work_tail; /*Producer index, written only by interrupts*/
+static uint32_t work_drop_cnt;
+
+/**********************
+ *      MACROS
+ ******************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Queue a callback to run from the next `os_timer_handler()` pass.
+ * Safe to call from interrupt context without a critical section.
+ * @param cb the function to run in thread context
+ * @param arg passed to `cb`
+ * @return OS_RES_OK: queued; OS_RES_INV: the ring is full
+ */
+os_res_t os_work_submit(os_work_cb_t cb, void * arg)
+{
+    uint32_t tail = work_tail;
+    if(tail - work_head >= OS_WORK_QUEUE_SIZE) {
+        work_drop_cnt++;
+        return OS_RES_INV;
+    }
+
+    work_ring[tail & WORK_QUEUE_MASK].cb  = cb;
+    work_ring[tail & WORK_QUEUE_MASK].arg = arg;
+
+    /*Publish the entry: the index store must not be reordered before the
+     *entry stores*/
+    __atomic_store_n(&work_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return OS_RES_OK;
+}
+
+/**
+ * Drain the ring and run the queued callbacks.
+ * At most `OS_WORK_QUEUE_SIZE` entries are run per call.
+ * @return the number of callbacks executed
+ */
+uint32_t _os_work_queue_process(void)
+{
+    uint32_t cnt = 0;
+    uint32_t head = work_head;
+
+    while(cnt < OS_WORK_QUEUE_SIZE &&
+          head != __atomic_load_n(&work_tail, __ATOMIC_ACQUIRE)) {
+        os_work_entry_t entry = work_ring[head & WORK_QUEUE_MASK];
+
+        /*Free the slot before the callback so a long callback does not
+         *keep the ring artificially full*/
+        head++;
+        __atomic_store_n(&work_head, head, __ATOMIC_RELEASE);
+
+        if(entry.cb) entry.cb(entry.arg);
+        cnt++;
+    }
+
+    return cnt;
+}
+
+/**
+ * Get the number of submissions dropped because the ring was full
+ * @return the drop count since boot
+ */
+uint32_t os_work_get_drop_cnt(void)
+{
+    return work_drop_cnt;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
@@ -0,0 +1,81 @@
+/**
+ * @file os_work_queue.h
+ * Deferred-work queue from interrupt handlers to the timer loop.
+ * A fixed capacity single-producer/single-consumer ring: interrupt
+ * handlers push `{callback, arg}` entries with a couple of stores and
+ * `os_timer_handler()` drains the ring before running the timers, so an
+ * interrupt is serviced on the very next handler pass instead of waiting
+ * for a polling timer period.
+ */
+
+#ifndef OS_WORK_QUEUE_H
+#define OS_WORK_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "os_types.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Capacity of the ring. Must be a power of two.*/
+#ifndef OS_WORK_QUEUE_SIZE
+#define OS_WORK_QUEUE_SIZE 32
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Deferred work submitted with `os_work_submit` executes this type of
+ * function in thread context.
+ */
+typedef void (*os_work_cb_t)(void * arg);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Queue a callback to run from the next `os_timer_handler()` pass.
+ * Safe to call from interrupt context without a critical section. All
+ * producers must share one interrupt priority (single producer); the
+ * single consumer is the timer loop.
+ * @param cb the function to run in thread context
+ * @param arg passed to `cb`
+ * @return OS_RES_OK: queued; OS_RES_INV: the ring is full
+ *         (the entry is dropped and counted, see `os_work_get_drop_cnt`)
+ */
+os_res_t os_work_submit(os_work_cb_t cb, void * arg);
+
+/**
+ * Drain the ring and run the queued callbacks.
+ * Called by `os_timer_handler()` before the timers; at most
+ * `OS_WORK_QUEUE_SIZE` entries are run per call so a re-submitting
+ * interrupt cannot starve the timers.
+ * @return the number of callbacks executed
+ */
+uint32_t _os_work_queue_process(void);
+
+/**
+ * Get the number of submissions dropped because the ring was full
+ * @return the drop count since boot
+ */
+uint32_t os_work_get_drop_cnt(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*OS_WORK_QUEUE_H*/
@@ -23,6 +23,13 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "os_timer.h"
+#include "os_mem.h"
+#include "os_uart.h"
+#include "os_hrtimer.h"
+#include "os_bench.h"
+#include "os_power.h"
+#include "os_trace.h"
+#include "os_boot.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -32,7 +39,9 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+/*SysTick is a 24 bit down-counter: at 280 MHz it can time at most ~59 ms,
+ *so longer idle periods are slept in chunks*/
+#define OS_SLEEP_MAX_MS 50U
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -45,7 +54,10 @@
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
-
+/*Milliseconds the running SysTick period stands for. 1 during normal
+ *ticking; os_sleep_wfi() raises it for the duration of a tickless sleep.
+ *SysTick_Handler() consumes it and resets it to 1.*/
+volatile uint32_t os_tick_period_ms = 1;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -54,12 +66,122 @@ void PeriphCommonClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_USART2_UART_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void os_sleep_wfi(uint32_t ms);
+static void os_sleep_deep(uint32_t ms);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+/**
+  * @brief  Sleep callback for os_run(): wait in WFI until the next timer deadline.
+  *         SysTick is re-programmed to fire at the deadline and restored to 1 ms
+  *         ticking afterwards. If the deadline fires, SysTick_Handler() accounts
+  *         the whole period; if another interrupt wakes the core earlier, the
+  *         milliseconds actually slept are accounted here.
+  * @param  ms milliseconds until the next ready timer
+  */
+static void os_sleep_wfi(uint32_t ms)
+{
+  if(ms == 0U) return;
+  if(ms > OS_SLEEP_MAX_MS) ms = OS_SLEEP_MAX_MS;
+
+  uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+
+  __disable_irq();
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk; /*Also clears a stale COUNTFLAG*/
+  os_tick_period_ms = ms;
+  SysTick->LOAD = ms * cycles_per_ms - 1U;
+  SysTick->VAL = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  __enable_irq();
+
+  __WFI();
+
+  __disable_irq();
+  uint32_t ctrl = SysTick->CTRL; /*Capture COUNTFLAG (reading clears it)*/
+  SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+  if(os_tick_period_ms == ms && ms > 1U) {
+    /*SysTick_Handler() did not run: the wakeup came from another interrupt
+     *or the deadline hit while interrupts were still masked*/
+    uint32_t elapsed_ms;
+    if(ctrl & SysTick_CTRL_COUNTFLAG_Msk) {
+      elapsed_ms = ms;
+      SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk; /*The pending tick is accounted here*/
+    }
+    else {
+      elapsed_ms = (ms * cycles_per_ms - SysTick->VAL) / cycles_per_ms;
+    }
+    os_tick_inc(elapsed_ms);
+    uwTick += elapsed_ms;
+  }
+
+  /*Back to normal 1 ms ticking*/
+  os_tick_period_ms = 1U;
+  SysTick->LOAD = cycles_per_ms - 1U;
+  SysTick->VAL = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  __enable_irq();
+}
+
+/**
+  * @brief  Deep variant of the sleep callback: short gaps stay on the tickless
+  *         WFI path, long gaps enter STOP mode with an LPTIM2 wakeup. SysTick
+  *         is parked across the STOP entry; os_power_stop() re-syncs the os
+  *         tick by the time actually slept, the HAL tick is accounted here and
+  *         the system clock is restored (the core wakes on the HSI).
+  * @param  ms milliseconds until the next ready timer
+  */
+static void os_sleep_deep(uint32_t ms)
+{
+  if(ms < OS_POWER_STOP_MIN_MS) {
+    os_sleep_wfi(ms);
+    return;
+  }
+
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+  uint32_t slept = os_power_stop(ms);
+  SystemClock_Config();
+  uwTick += slept;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+}
+
+/*Boot steps (see os_boot.h): everything that is not on the 500 ms
+ *power-on critical path completes from timer passes after os_run()
+ *started, overlapping the oscillator settle times*/
+#define BOOT_STEP_UART  (1UL << 0)
+#define BOOT_STEP_POWER (1UL << 1)
+#define BOOT_STEP_SLEEP (1UL << 2)
+
+static void boot_uart_start(void)
+{
+  MX_USART2_UART_Init();
+  os_uart_init();
+#if OS_USE_TRACE
+  os_trace_init();
+#endif
+#if OS_USE_BENCH
+  /*The bench drives os_timer_handler itself and spin-waits on ticks:
+   *defer it out of this timer pass into the os_run() loop*/
+  os_run_defer(os_bench_run);
+#endif
+}
 
+static void boot_power_start(void)
+{
+  os_power_init();
+}
+
+static void boot_sleep_start(void)
+{
+  /*STOP mode needs the settled LSI: upgrade from the shallow WFI sleep
+   *only once the POWER step reported ready*/
+  os_run_set_sleep_cb(os_sleep_deep);
+}
+
+static os_boot_step_t boot_uart_step  = {.id = BOOT_STEP_UART, .start_cb = boot_uart_start};
+static os_boot_step_t boot_power_step = {.id = BOOT_STEP_POWER, .start_cb = boot_power_start, .ready_cb = os_power_ready};
+static os_boot_step_t boot_sleep_step = {.id = BOOT_STEP_SLEEP, .deps = BOOT_STEP_POWER, .start_cb = boot_sleep_start};
 /* USER CODE END 0 */
 
 /**
@@ -93,9 +215,18 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
-  MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
-
+  /*MX_USART2_UART_Init() moved off the critical path: the UART comes up
+   *as the BOOT_STEP_UART boot step after os_run() started*/
+  os_mem_init();
+  _os_timer_core_init();
+  os_hrtimer_init();
+  os_run_set_sleep_cb(os_sleep_wfi); /*Upgraded to os_sleep_deep by BOOT_STEP_SLEEP*/
+
+  os_boot_add_step(&boot_uart_step);
+  os_boot_add_step(&boot_power_step);
+  os_boot_add_step(&boot_sleep_step);
+  os_boot_start();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -103,7 +234,7 @@ int main(void)
   while (1)
   {
     /* USER CODE END WHILE */
-	  os_timer_handler();
+	  os_run();
     /* USER CODE BEGIN 3 */
   }
   /* USER CODE END 3 */
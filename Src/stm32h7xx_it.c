@@ -22,6 +22,11 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "os_hal_tick.h"
+#include "os_hal_dma.h"
+#include "os_uart.h"
+#include "os_hrtimer.h"
+#include "os_power.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -57,7 +62,7 @@
 /* External variables --------------------------------------------------------*/
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
-
+extern volatile uint32_t os_tick_period_ms;
 /* USER CODE END EV */
 
 /******************************************************************************/
@@ -183,7 +188,12 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  /*During a tickless sleep (see os_sleep_wfi() in main.c) this one interrupt
+   *stands for a whole multi-millisecond period*/
+  uint32_t period = os_tick_period_ms;
+  os_tick_period_ms = 1U;
+  os_tick_inc(period);
+  uwTick += period - 1U; /*HAL_IncTick() below adds the last millisecond*/
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
@@ -204,7 +214,7 @@ void SysTick_Handler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  os_uart_irq_handler();
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
@@ -213,5 +223,43 @@ void USART2_IRQHandler(void)
 }
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief This function handles MDMA global interrupt.
+  */
+void MDMA_IRQHandler(void)
+{
+  os_hal_dma_irq_handler();
+}
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (os_uart TX).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  os_uart_tx_dma_irq_handler();
+}
+
+/**
+  * @brief This function handles DMA1 stream1 global interrupt (os_uart RX).
+  */
+void DMA1_Stream1_IRQHandler(void)
+{
+  os_uart_rx_dma_irq_handler();
+}
 
+/**
+  * @brief This function handles TIM2 global interrupt (os_hrtimer).
+  */
+void TIM2_IRQHandler(void)
+{
+  os_hrtimer_irq_handler();
+}
+
+/**
+  * @brief This function handles LPTIM2 global interrupt (os_power STOP wakeup).
+  */
+void LPTIM2_IRQHandler(void)
+{
+  os_power_lptim_irq_handler();
+}
 /* USER CODE END 1 */
@@ -30,6 +30,8 @@
 #include <sys/time.h>
 #include <sys/times.h>
 
+#include "os_uart.h"
+
 
 /* Variables */
 extern int __io_putchar(int ch) __attribute__((weak));
@@ -77,15 +79,21 @@ __attribute__((weak)) int _read(int file, char *ptr, int len)
   return len;
 }
 
+/* Output is queued into the DMA driven UART ring (see OS/os_uart.c) and
+ * sent in the background, so a printf from a timer callback returns in
+ * microseconds instead of blocking the scheduler for the line time.
+ * The ring size is set with OS_UART_TX_BUF_SIZE; when it overflows the
+ * excess bytes are dropped and counted: read the counter with
+ * os_uart_get_tx_drop_cnt(). */
 __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
   (void)file;
-  int DataIdx;
-
-  for (DataIdx = 0; DataIdx < len; DataIdx++)
+  if (len < 0)
   {
-    __io_putchar(*ptr++);
+    return -1;
   }
+
+  os_uart_write(ptr, (size_t)len);
   return len;
 }
 
@@ -43,6 +43,14 @@ defined in linker script */
 .word  _sbss
 /* end address for the .bss section. defined in linker script */
 .word  _ebss
+/* load/start/end addresses for the .itcm_text section. defined in linker script */
+.word  _siitcm
+.word  _sitcm
+.word  _eitcm
+/* load/start/end addresses for the .dtcm_data section. defined in linker script */
+.word  _sidtcm
+.word  _sdtcm
+.word  _edtcm
 /* stack used for SystemInit_ExtMemCtl; always internal RAM used */
 
 /**
@@ -92,7 +100,41 @@ FillZerobss:
 LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
-  
+
+/* Copy the hot-path code from flash to the ITCM (OS_HOT_FUNC) */
+  ldr r0, =_sitcm
+  ldr r1, =_eitcm
+  ldr r2, =_siitcm
+  movs r3, #0
+  b LoopCopyItcmInit
+
+CopyItcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcmInit
+
+/* Copy the hot-path data from flash to the DTCM (OS_FAST_DATA) */
+  ldr r0, =_sdtcm
+  ldr r1, =_edtcm
+  ldr r2, =_sidtcm
+  movs r3, #0
+  b LoopCopyDtcmInit
+
+CopyDtcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcmInit
+
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/